@@ -22,3 +22,18 @@ function(get_resources PATH COMPILED_RESOURCES)
 		LIST(APPEND ${COMPILED_RESOURCES} ${OUTPUT_FILE})
 	ENDFOREACH()
 endfunction()
+
+function(get_context_images PATH TOOL CONTEXT_IMAGES)
+	FILE(GLOB_RECURSE RESOURCE_LIST ${PATH})
+	FOREACH(INPUT_FILE ${RESOURCE_LIST})
+		get_filename_component(FILE_NAME ${INPUT_FILE} NAME_WE)
+		string(MAKE_C_IDENTIFIER ${FILE_NAME}_ctx C_STYLE_OUTPUT_VAR_NAME)
+		SET(OUTPUT_FILE ${CMAKE_CURRENT_BINARY_DIR}/resources/${FILE_NAME}_ctx.h)
+		add_custom_command(OUTPUT ${OUTPUT_FILE}
+			COMMAND ${TOOL} --header ${C_STYLE_OUTPUT_VAR_NAME} ${INPUT_FILE} ${OUTPUT_FILE}
+			DEPENDS ${TOOL} ${INPUT_FILE}
+			COMMENT "Compiling the ${FILE_NAME} context image")
+		LIST(APPEND ${CONTEXT_IMAGES} ${OUTPUT_FILE})
+	ENDFOREACH()
+	SET(${CONTEXT_IMAGES} ${${CONTEXT_IMAGES}} PARENT_SCOPE)
+endfunction()
@@ -43,11 +43,15 @@
 #include "iiod/context/adalm2000/devices/m2k_dac.hpp"
 #include "iiod/context/adalm2000/devices/m2k_logic_rx.hpp"
 #include "iiod/context/adalm2000/devices/m2k_logic_tx.hpp"
-#include "utils/attr_ops_xml.hpp"
+#include "utils/attr_ops.hpp"
+#include "utils/context_image.hpp"
 #include "utils/utility.hpp"
 
+#if defined(IIO_EMU_PRECOMPILED_CONTEXTS)
+#include <adalm2000_ctx.h>
+#else
 #include <adalm2000_xml.h>
-#include <libxml/tree.h>
+#endif
 
 using namespace iio_emu;
 
@@ -63,15 +67,32 @@ enum CALIBRATION_COEFFICIENT
 	ADC_GAIN_NEG = 7
 };
 
+#if defined(IIO_EMU_PRECOMPILED_CONTEXTS)
+// the image is compiled from adalm2000.xml at build time
+static ContextImage* loadContextImage()
+{
+	auto image = new ContextImage();
+	if (image->open(adalm2000_ctx, sizeof(adalm2000_ctx)) < 0) {
+		delete image;
+		return nullptr;
+	}
+	return image;
+}
+#endif
+
 Adalm2000Context::Adalm2000Context()
+#if defined(IIO_EMU_PRECOMPILED_CONTEXTS)
+	: GenericXmlContext(loadContextImage())
+#else
 	: GenericXmlContext(reinterpret_cast<const char*>(adalm2000_xml), sizeof(adalm2000_xml))
+#endif
 {
 	// devices
-	auto adc = new M2kADC("iio:device0", m_doc);
-	auto dac_a = new M2kDAC("iio:device6", m_doc);
-	auto dac_b = new M2kDAC("iio:device7", m_doc);
-	auto logic_rx = new M2kLogicRX("iio:device10", m_doc);
-	auto logic_tx = new M2kLogicTX("iio:device9", m_doc);
+	auto adc = new M2kADC("iio:device0", m_store);
+	auto dac_a = new M2kDAC("iio:device6", m_store);
+	auto dac_b = new M2kDAC("iio:device7", m_store);
+	auto logic_rx = new M2kLogicRX("iio:device10", m_store);
+	auto logic_tx = new M2kLogicTX("iio:device9", m_store);
 
 	addDevice(adc);
 	addDevice(dac_a);
@@ -96,29 +117,15 @@ Adalm2000Context::Adalm2000Context()
 	m_ps_current_values = std::vector<std::string>(2);
 }
 
-Adalm2000Context::~Adalm2000Context()
-{
-	delete m_iiodOps;
-	m_iiodOps = nullptr;
-
-	xmlFreeDoc(m_doc);
-	xmlCleanupParser();
-	m_doc = nullptr;
-
-	delete m_ctx_xml;
-	m_ctx_xml = nullptr;
-
-	for (auto dev : m_devices) {
-		delete dev;
-		dev = nullptr;
-	}
-}
+// the context image and the devices are released by GenericXmlContext
+Adalm2000Context::~Adalm2000Context() = default;
 
 ssize_t Adalm2000Context::chWriteAttr(const char* device_id, const char* channel, bool ch_out, const char* attr,
 				      const char* buf, size_t len)
 {
 	auto ret = GenericXmlContext::chWriteAttr(device_id, channel, ch_out, attr, buf, len);
 	if (!strncmp(device_id, "iio:device3", sizeof("iio:device3") - 1)) {
+		std::lock_guard<std::mutex> lock(m_ps_mutex);
 
 		std::string channelRead;
 		unsigned short channelIdx;
@@ -131,14 +138,16 @@ ssize_t Adalm2000Context::chWriteAttr(const char* device_id, const char* channel
 			channelRead = "voltage1";
 		}
 
-		if (!strncmp(attr, "raw", sizeof("raw") - 1)) {
-			auto voltage = convertPSDACRawToVolts(channelIdx, std::stoi(buf));
+		double raw = 0.0;
+		if (!strncmp(attr, "raw", sizeof("raw") - 1) &&
+		    !read_channel_attr_number(m_store, device_id, channel, ch_out, "raw", &raw)) {
+			auto voltage = convertPSDACRawToVolts(channelIdx, static_cast<int>(raw));
 			auto result = convertPSADCVoltsToRaw(channelIdx, voltage);
 			m_ps_current_values.at(channelIdx) = std::to_string(result);
 		}
 
 		char buffer[IIOD_BUFFER_SIZE];
-		read_channel_attr(m_doc, device_id, channel, ch_out, "powerdown", buffer, IIOD_BUFFER_SIZE);
+		read_channel_attr(m_store, device_id, channel, ch_out, "powerdown", buffer, IIOD_BUFFER_SIZE);
 
 		if (!strncmp(buffer, "1", 1)) {
 			GenericXmlContext::chWriteAttr("iio:device13", channelRead.c_str(), false, "raw", "0", 1);
@@ -156,14 +165,14 @@ void Adalm2000Context::loadPSCalibCoef()
 	m_ps_calib_coefficients.clear();
 	m_ps_calib_coefficients.reserve(8);
 
-	char buf[IIOD_BUFFER_SIZE];
 	std::vector<std::string> calibAttrs = {"cal,offset_pos_dac", "cal,gain_pos_dac",   "cal,offset_pos_adc",
 					       "cal,gain_pos_adc",   "cal,offset_neg_dac", "cal,gain_neg_dac",
 					       "cal,offset_neg_adc", "cal,gain_neg_adc"};
 
 	for (auto& attrName : calibAttrs) {
-		read_context_attr(m_doc, attrName.c_str(), buf, IIOD_BUFFER_SIZE);
-		m_ps_calib_coefficients.push_back(safe_stod(buf));
+		double coefficient = 0.0;
+		read_context_attr_number(m_store, attrName.c_str(), &coefficient);
+		m_ps_calib_coefficients.push_back(coefficient);
 	}
 }
 
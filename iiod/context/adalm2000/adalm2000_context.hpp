@@ -42,6 +42,7 @@
 
 #include "iiod/context/generic_xml/generic_xml_context.hpp"
 
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -66,6 +67,7 @@ private:
 	std::vector<double> m_ps_write_coefficients;
 	std::vector<double> m_ps_read_coefficients;
 	std::vector<std::string> m_ps_current_values;
+	std::mutex m_ps_mutex;
 };
 } // namespace iio_emu
 #endif // IIO_EMU_ADALM2000_CONTEXT_HPP
@@ -39,7 +39,7 @@
 
 #include "m2k_adc.hpp"
 
-#include "utils/attr_ops_xml.hpp"
+#include "utils/attr_ops.hpp"
 #include "utils/utility.hpp"
 
 #include <thread>
@@ -51,10 +51,10 @@
 
 using namespace iio_emu;
 
-M2kADC::M2kADC(const char* device_id, struct _xmlDoc* doc)
+M2kADC::M2kADC(const char* device_id, AttrStore* store)
 {
 	m_device_id = device_id;
-	m_doc = doc;
+	m_store = store;
 
 	m_connections = std::vector<std::pair<AbstractDeviceOut*, unsigned short>>(M2K_ADC_CHANNELS);
 
@@ -68,12 +68,24 @@ M2kADC::M2kADC(const char* device_id, struct _xmlDoc* doc)
 	m_filter_compensation_table[1E5] = 1.15;
 	m_filter_compensation_table[1E4] = 1.20;
 	m_filter_compensation_table[1E3] = 1.26;
+
+	// the vertical offset follows the power supply DAC and the gain of the front end
+	subscribe_channel_attr(m_store, "iio:device11", "voltage0", false, "gain", this);
+	subscribe_channel_attr(m_store, "iio:device11", "voltage1", false, "gain", this);
+	subscribe_channel_attr(m_store, "iio:device2", "voltage2", true, "raw", this);
+	subscribe_channel_attr(m_store, "iio:device2", "voltage3", true, "raw", this);
+	subscribe_channel_attr(m_store, "iio:device0", "voltage0", false, "calibbias", this);
+	subscribe_channel_attr(m_store, "iio:device0", "voltage1", false, "calibbias", this);
+	subscribe_device_attr(m_store, "iio:device0", "sampling_frequency", IIO_ATTR_TYPE_DEVICE, this);
+	subscribe_device_attr(m_store, "iio:device0", "oversampling_ratio", IIO_ATTR_TYPE_DEVICE, this);
+	loadCalibValues();
 }
 
 M2kADC::~M2kADC()
 {
+	unsubscribe_attrs(m_store, this);
 	for (auto range : m_range) {
-		delete range;
+		delete[] range;
 	}
 }
 
@@ -102,7 +114,6 @@ int32_t M2kADC::get_mask(uint32_t* mask)
 ssize_t M2kADC::read_dev(char* pbuf, size_t offset, size_t bytes_count)
 {
 	UNUSED(offset);
-	loadCalibValues();
 
 	std::vector<int16_t> samples;
 	samples.reserve(bytes_count / M2K_ADC_SAMPLE_SIZE);
@@ -175,41 +186,52 @@ double M2kADC::getFilterCompensation() const
 	return compensation;
 }
 
+void M2kADC::attrChanged(size_t slot)
+{
+	UNUSED(slot);
+	std::lock_guard<std::mutex> lock(getMutex());
+	loadCalibValues();
+}
+
 void M2kADC::loadCalibValues()
 {
-	char tmp_attr[IIOD_BUFFER_SIZE];
+	double dacRaw = 0.0;
+	double calibbias = 0.0;
+	double value = 0.0;
 
-	read_channel_attr(m_doc, "iio:device11", "voltage0", false, "gain", m_range.at(M2K_ADC_CHANNEL_1),
+	read_channel_attr(m_store, "iio:device11", "voltage0", false, "gain", m_range.at(M2K_ADC_CHANNEL_1),
 			  IIOD_BUFFER_SIZE);
-	read_channel_attr(m_doc, "iio:device11", "voltage1", false, "gain", m_range.at(M2K_ADC_CHANNEL_2),
+	read_channel_attr(m_store, "iio:device11", "voltage1", false, "gain", m_range.at(M2K_ADC_CHANNEL_2),
 			  IIOD_BUFFER_SIZE);
 
-	read_channel_attr(m_doc, "iio:device2", "voltage2", true, "raw", tmp_attr, IIOD_BUFFER_SIZE);
-	m_hw_offset.at(M2K_ADC_CHANNEL_1) = safe_stod(tmp_attr);
-	read_channel_attr(m_doc, "iio:device0", "voltage0", false, "calibbias", tmp_attr, IIOD_BUFFER_SIZE);
-	m_hw_offset.at(M2K_ADC_CHANNEL_1) -= safe_stod(tmp_attr);
-	m_hw_offset.at(M2K_ADC_CHANNEL_1) = convertRawToVoltsVerticalOffset(
-		static_cast<int16_t>(m_hw_offset.at(M2K_ADC_CHANNEL_1)), M2K_ADC_CHANNEL_1);
-
-	read_channel_attr(m_doc, "iio:device2", "voltage3", true, "raw", tmp_attr, IIOD_BUFFER_SIZE);
-	m_hw_offset.at(M2K_ADC_CHANNEL_2) = safe_stod(tmp_attr);
-	read_channel_attr(m_doc, "iio:device0", "voltage1", false, "calibbias", tmp_attr, IIOD_BUFFER_SIZE);
-	m_hw_offset.at(M2K_ADC_CHANNEL_2) -= safe_stod(tmp_attr);
-	m_hw_offset.at(M2K_ADC_CHANNEL_2) = convertRawToVoltsVerticalOffset(
-		static_cast<int16_t>(m_hw_offset.at(M2K_ADC_CHANNEL_2)), M2K_ADC_CHANNEL_2);
-
-	read_device_attr(m_doc, "iio:device0", "sampling_frequency", tmp_attr, IIOD_BUFFER_SIZE, IIO_ATTR_TYPE_DEVICE);
-	m_samplerate = safe_stod(tmp_attr);
-
-	read_device_attr(m_doc, "iio:device0", "oversampling_ratio", tmp_attr, IIOD_BUFFER_SIZE, IIO_ATTR_TYPE_DEVICE);
-	m_oversampling_ratio = static_cast<unsigned int>(std::stoi(tmp_attr));
+	read_channel_attr_number(m_store, "iio:device2", "voltage2", true, "raw", &dacRaw);
+	read_channel_attr_number(m_store, "iio:device0", "voltage0", false, "calibbias", &calibbias);
+	m_hw_offset.at(M2K_ADC_CHANNEL_1) =
+		convertRawToVoltsVerticalOffset(static_cast<int16_t>(dacRaw - calibbias), M2K_ADC_CHANNEL_1);
+
+	dacRaw = 0.0;
+	calibbias = 0.0;
+	read_channel_attr_number(m_store, "iio:device2", "voltage3", true, "raw", &dacRaw);
+	read_channel_attr_number(m_store, "iio:device0", "voltage1", false, "calibbias", &calibbias);
+	m_hw_offset.at(M2K_ADC_CHANNEL_2) =
+		convertRawToVoltsVerticalOffset(static_cast<int16_t>(dacRaw - calibbias), M2K_ADC_CHANNEL_2);
+
+	read_device_attr_number(m_store, "iio:device0", "sampling_frequency", &value, IIO_ATTR_TYPE_DEVICE);
+	m_samplerate = value;
+
+	value = 0.0;
+	read_device_attr_number(m_store, "iio:device0", "oversampling_ratio", &value, IIO_ATTR_TYPE_DEVICE);
+	m_oversampling_ratio = static_cast<unsigned int>(value);
 }
 
 void M2kADC::resample(AbstractDeviceOut* devOut, size_t size, unsigned int ratio, std::vector<double>& dest)
 {
 	std::vector<double> tmp_samples(size);
 
-	devOut->transfer_samples_to_RX_device(reinterpret_cast<char*>(tmp_samples.data()), size);
+	{
+		std::lock_guard<std::mutex> lock(devOut->getMutex());
+		devOut->transfer_samples_to_RX_device(reinterpret_cast<char*>(tmp_samples.data()), size);
+	}
 
 	if (ratio < 2) {
 		dest = tmp_samples;
@@ -23,18 +23,19 @@
 #define IIO_EMU_M2K_ADC_HPP
 
 #include "iiod/devices/abstract_device_in.hpp"
+#include "utils/attr_listener.hpp"
 
 #include <map>
 #include <vector>
 
-struct _xmlDoc;
-
 namespace iio_emu {
 
-class M2kADC : public AbstractDeviceIn
+class AttrStore;
+
+class M2kADC : public AbstractDeviceIn, public AttrListener
 {
 public:
-	M2kADC(const char* device_id, struct _xmlDoc* doc);
+	M2kADC(const char* device_id, AttrStore* store);
 	~M2kADC() override;
 
 	int32_t open_dev(size_t sample_size, uint32_t mask, bool cyclic) override;
@@ -48,8 +49,10 @@ public:
 	void connectDevice(unsigned short channel_in, AbstractDeviceOut* deviceOut,
 			   unsigned short channel_out) override;
 
+	void attrChanged(size_t slot) override;
+
 private:
-	struct _xmlDoc* m_doc;
+	AttrStore* m_store;
 	std::vector<std::pair<AbstractDeviceOut*, unsigned short>> m_connections;
 
 	double m_samplerate;
@@ -39,17 +39,17 @@
 
 #include "m2k_dac.hpp"
 
-#include "utils/attr_ops_xml.hpp"
+#include "utils/attr_ops.hpp"
 #include "utils/utility.hpp"
 
 #include <vector>
 
 using namespace iio_emu;
 
-M2kDAC::M2kDAC(const char* device_id, struct _xmlDoc* doc)
+M2kDAC::M2kDAC(const char* device_id, AttrStore* store)
 {
 	m_device_id = device_id;
-	m_doc = doc;
+	m_store = store;
 	m_reset_buffer = true;
 
 	m_current_index = 0;
@@ -62,14 +62,17 @@ M2kDAC::M2kDAC(const char* device_id, struct _xmlDoc* doc)
 	m_filter_compensation_table[75E3] = 1.776357;
 	m_filter_compensation_table[75E2] = 1.355253;
 	m_filter_compensation_table[75E1] = 1.033976;
+
+	subscribe_device_attr(m_store, m_device_id, "sampling_frequency", IIO_ATTR_TYPE_DEVICE, this);
+	subscribe_device_attr(m_store, m_device_id, "oversampling_ratio", IIO_ATTR_TYPE_DEVICE, this);
+	loadCalibValues();
 }
 
-M2kDAC::~M2kDAC() {}
+M2kDAC::~M2kDAC() { unsubscribe_attrs(m_store, this); }
 
 int32_t M2kDAC::open_dev(size_t sample_size, uint32_t mask, bool cyclic)
 {
 	UNUSED(sample_size);
-	loadCalibValues();
 	m_cyclic = cyclic;
 	m_enable = false;
 	if (mask) {
@@ -128,20 +131,27 @@ double M2kDAC::convertRawToVolts(int16_t raw) const
 
 double M2kDAC::getFilterCompensation() const { return m_filter_compensation_table.at(m_samplerate); }
 
+void M2kDAC::attrChanged(size_t slot)
+{
+	UNUSED(slot);
+	std::lock_guard<std::mutex> lock(getMutex());
+	loadCalibValues();
+}
+
 void M2kDAC::loadCalibValues()
 {
-	char tmp_attr[IIOD_BUFFER_SIZE];
+	double value = 0.0;
 
-	read_device_attr(m_doc, m_device_id, "sampling_frequency", tmp_attr, IIOD_BUFFER_SIZE, IIO_ATTR_TYPE_DEVICE);
-	m_samplerate = safe_stod(tmp_attr);
+	read_device_attr_number(m_store, m_device_id, "sampling_frequency", &value, IIO_ATTR_TYPE_DEVICE);
+	m_samplerate = value;
 
-	read_device_attr(m_doc, m_device_id, "oversampling_ratio", tmp_attr, IIOD_BUFFER_SIZE, IIO_ATTR_TYPE_DEVICE);
-	m_oversampling_ratio = static_cast<unsigned int>(std::stoi(tmp_attr));
+	value = 0.0;
+	read_device_attr_number(m_store, m_device_id, "oversampling_ratio", &value, IIO_ATTR_TYPE_DEVICE);
+	m_oversampling_ratio = static_cast<unsigned int>(value);
 }
 
 std::vector<double> M2kDAC::resample()
 {
-	loadCalibValues();
 	auto ratio = static_cast<unsigned int>(75E6 / (m_samplerate / m_oversampling_ratio));
 
 	if (ratio < 2) {
@@ -41,18 +41,19 @@
 #define IIO_EMU_M2K_DAC_HPP
 
 #include "iiod/devices/abstract_device_out.hpp"
+#include "utils/attr_listener.hpp"
 
 #include <map>
 #include <vector>
 
-struct _xmlDoc;
-
 namespace iio_emu {
 
-class M2kDAC : public AbstractDeviceOut
+class AttrStore;
+
+class M2kDAC : public AbstractDeviceOut, public AttrListener
 {
 public:
-	M2kDAC(const char* device_id, struct _xmlDoc* doc);
+	M2kDAC(const char* device_id, AttrStore* store);
 	~M2kDAC() override;
 
 	int32_t open_dev(size_t sample_size, uint32_t mask, bool cyclic) override;
@@ -66,8 +67,10 @@ public:
 
 	void transfer_samples_to_RX_device(char* buf, size_t samples_count) override;
 
+	void attrChanged(size_t slot) override;
+
 private:
-	struct _xmlDoc* m_doc;
+	AttrStore* m_store;
 	bool m_cyclic;
 	bool m_enable;
 
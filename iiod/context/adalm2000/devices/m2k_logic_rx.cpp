@@ -39,20 +39,23 @@
 
 #include "m2k_logic_rx.hpp"
 
-#include "utils/attr_ops_xml.hpp"
+#include "utils/attr_ops.hpp"
 #include "utils/utility.hpp"
 
 using namespace iio_emu;
 
-M2kLogicRX::M2kLogicRX(const char* device_id, struct _xmlDoc* doc)
+M2kLogicRX::M2kLogicRX(const char* device_id, AttrStore* store)
 {
 	m_device_id = device_id;
-	m_doc = doc;
+	m_store = store;
 
 	m_connections = std::vector<std::pair<AbstractDeviceOut*, unsigned short>>(1);
+
+	subscribe_device_attr(m_store, m_device_id, "sampling_frequency", IIO_ATTR_TYPE_DEVICE, this);
+	loadValues();
 }
 
-M2kLogicRX::~M2kLogicRX() {}
+M2kLogicRX::~M2kLogicRX() { unsubscribe_attrs(m_store, this); }
 
 int32_t M2kLogicRX::open_dev(size_t sample_size, uint32_t mask, bool cyclic)
 {
@@ -93,25 +96,35 @@ void M2kLogicRX::connectDevice(unsigned short channel_in, AbstractDeviceOut* dev
 std::vector<uint16_t> M2kLogicRX::resample(unsigned short channel, size_t len)
 {
 	UNUSED(channel);
-	loadValues();
 	std::vector<uint16_t> samples;
 	auto ratio = static_cast<unsigned int>(1E8 / m_samplerate);
 
 	std::vector<uint16_t> tmp_samples((len / 2) * ratio);
-	m_connections.at(0).first->transfer_samples_to_RX_device(reinterpret_cast<char*>(tmp_samples.data()),
-								 (len / 2) * ratio);
+	AbstractDeviceOut* deviceOut = m_connections.at(0).first;
+	{
+		std::lock_guard<std::mutex> lock(deviceOut->getMutex());
+		deviceOut->transfer_samples_to_RX_device(reinterpret_cast<char*>(tmp_samples.data()),
+							 (len / 2) * ratio);
+	}
 
 	digital_decimation(tmp_samples, samples, ratio);
 
 	return samples;
 }
 
+void M2kLogicRX::attrChanged(size_t slot)
+{
+	UNUSED(slot);
+	std::lock_guard<std::mutex> lock(getMutex());
+	loadValues();
+}
+
 void M2kLogicRX::loadValues()
 {
-	char tmp_attr[IIOD_BUFFER_SIZE];
+	double value = 0.0;
 
-	read_device_attr(m_doc, m_device_id, "sampling_frequency", tmp_attr, IIOD_BUFFER_SIZE, IIO_ATTR_TYPE_DEVICE);
-	m_samplerate = safe_stod(tmp_attr);
+	read_device_attr_number(m_store, m_device_id, "sampling_frequency", &value, IIO_ATTR_TYPE_DEVICE);
+	m_samplerate = value;
 }
 
 int32_t M2kLogicRX::cancel_buffer() { return 0; }
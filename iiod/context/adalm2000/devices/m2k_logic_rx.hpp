@@ -41,15 +41,16 @@
 #define IIO_EMU_M2K_LOGIC_RX_HPP
 
 #include "iiod/devices/abstract_device_in.hpp"
-
-struct _xmlDoc;
+#include "utils/attr_listener.hpp"
 
 namespace iio_emu {
 
-class M2kLogicRX : public AbstractDeviceIn
+class AttrStore;
+
+class M2kLogicRX : public AbstractDeviceIn, public AttrListener
 {
 public:
-	M2kLogicRX(const char* device_id, struct _xmlDoc* doc);
+	M2kLogicRX(const char* device_id, AttrStore* store);
 	~M2kLogicRX() override;
 
 	int32_t open_dev(size_t sample_size, uint32_t mask, bool cyclic) override;
@@ -64,8 +65,10 @@ public:
 	void connectDevice(unsigned short channel_in, AbstractDeviceOut* deviceOut,
 			   unsigned short channel_out) override;
 
+	void attrChanged(size_t slot) override;
+
 private:
-	struct _xmlDoc* m_doc;
+	AttrStore* m_store;
 	std::vector<std::pair<AbstractDeviceOut*, unsigned short>> m_connections;
 
 	double m_samplerate;
@@ -39,21 +39,24 @@
 
 #include "m2k_logic_tx.hpp"
 
-#include "utils/attr_ops_xml.hpp"
+#include "utils/attr_ops.hpp"
 #include "utils/utility.hpp"
 
 using namespace iio_emu;
 
-M2kLogicTX::M2kLogicTX(const char* device_id, struct _xmlDoc* doc)
+M2kLogicTX::M2kLogicTX(const char* device_id, AttrStore* store)
 {
 	m_device_id = device_id;
-	m_doc = doc;
+	m_store = store;
 	m_current_index = 0;
 
 	m_reset_buffer = false;
+
+	subscribe_device_attr(m_store, m_device_id, "sampling_frequency", IIO_ATTR_TYPE_DEVICE, this);
+	loadValues();
 }
 
-M2kLogicTX::~M2kLogicTX() {}
+M2kLogicTX::~M2kLogicTX() { unsubscribe_attrs(m_store, this); }
 
 int32_t M2kLogicTX::open_dev(size_t sample_size, uint32_t mask, bool cyclic)
 {
@@ -104,7 +107,6 @@ ssize_t M2kLogicTX::transfer_mem_to_dev(size_t bytes_count)
 
 std::vector<uint16_t> M2kLogicTX::resample()
 {
-	loadValues();
 	auto ratio = static_cast<unsigned int>(1E8 / m_samplerate);
 
 	if (ratio < 2) {
@@ -117,12 +119,19 @@ std::vector<uint16_t> M2kLogicTX::resample()
 	return samples;
 }
 
+void M2kLogicTX::attrChanged(size_t slot)
+{
+	UNUSED(slot);
+	std::lock_guard<std::mutex> lock(getMutex());
+	loadValues();
+}
+
 void M2kLogicTX::loadValues()
 {
-	char tmp_attr[IIOD_BUFFER_SIZE];
+	double value = 0.0;
 
-	read_device_attr(m_doc, m_device_id, "sampling_frequency", tmp_attr, IIOD_BUFFER_SIZE, IIO_ATTR_TYPE_DEVICE);
-	m_samplerate = safe_stod(tmp_attr);
+	read_device_attr_number(m_store, m_device_id, "sampling_frequency", &value, IIO_ATTR_TYPE_DEVICE);
+	m_samplerate = value;
 }
 
 void M2kLogicTX::transfer_samples_to_RX_device(char* buf, size_t samples_count)
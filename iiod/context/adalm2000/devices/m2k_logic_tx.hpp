@@ -41,15 +41,16 @@
 #define IIO_EMU_M2K_LOGIC_TX_HPP
 
 #include "iiod/devices/abstract_device_out.hpp"
-
-struct _xmlDoc;
+#include "utils/attr_listener.hpp"
 
 namespace iio_emu {
 
-class M2kLogicTX : public AbstractDeviceOut
+class AttrStore;
+
+class M2kLogicTX : public AbstractDeviceOut, public AttrListener
 {
 public:
-	M2kLogicTX(const char* device_id, struct _xmlDoc* doc);
+	M2kLogicTX(const char* device_id, AttrStore* store);
 	~M2kLogicTX() override;
 
 	int32_t open_dev(size_t sample_size, uint32_t mask, bool cyclic) override;
@@ -63,8 +64,10 @@ public:
 
 	void transfer_samples_to_RX_device(char* buf, size_t samples_count) override;
 
+	void attrChanged(size_t slot) override;
+
 private:
-	struct _xmlDoc* m_doc;
+	AttrStore* m_store;
 
 	std::vector<uint16_t> m_samples;
 	unsigned int m_current_index;
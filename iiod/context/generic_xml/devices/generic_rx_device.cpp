@@ -42,64 +42,142 @@
 #include "utils/logger.hpp"
 #include "utils/utility.hpp"
 
-using namespace iio_emu;
+#include <cerrno>
+#include <cstring>
+#if !defined(_WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-const static int BUF_SIZE = 4096;
+using namespace iio_emu;
 
-GenericRXDevice::GenericRXDevice(const char* device_id, const char* filePath)
+GenericRXDevice::GenericRXDevice(const char* device_id, const char* filePath, bool cyclic)
 	: m_filePath(filePath)
+	, m_position(0)
+	, m_cyclic(cyclic)
+	, m_mask(0)
+	, m_loopback(nullptr)
+#if !defined(_WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
+	, m_fd(-1)
+#endif
 {
 	auto tmpArray = new char[strlen(device_id) + 1];
-	strncpy(tmpArray, device_id, strlen(device_id));
+	memcpy(tmpArray, device_id, strlen(device_id) + 1);
 	m_device_id = tmpArray;
 }
 
-GenericRXDevice::~GenericRXDevice() { delete[] m_device_id; }
-#include "iostream"
+GenericRXDevice::~GenericRXDevice()
+{
+#if !defined(_WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
+	if (m_fd >= 0) {
+		::close(m_fd);
+	}
+#endif
+	delete[] m_device_id;
+}
+
 ssize_t GenericRXDevice::read_dev(char* pbuf, size_t offset, size_t bytes_count)
 {
 	UNUSED(offset);
 
-	m_input = std::fstream(m_filePath, std::ios::in | std::ios::binary);
-	if (!m_input) {
+	if (m_loopback) {
+		m_loopback->transfer_samples_to_RX_device(pbuf, bytes_count);
+		return static_cast<ssize_t>(bytes_count);
+	}
+
+	if (!openFile()) {
 		Logger::log(IIO_EMU_FATAL, {"Invalid file path: ", m_filePath});
 		return -1;
 	}
 
-	m_input.seekg(std::ios::beg);
+	size_t count = 0;
+	while (count < bytes_count) {
+		size_t chunk = readFile(pbuf + count, bytes_count - count);
+		if (chunk == 0) {
+			// an empty file doesn't loop
+			if (!m_cyclic || m_position == 0) {
+				break;
+			}
+			m_position = 0;
+		}
+		count += chunk;
+	}
+
+	// past the end of the file
+	memset(pbuf + count, 0, bytes_count - count);
 
-	m_input.read(pbuf, static_cast<long>(bytes_count));
+	return static_cast<ssize_t>(bytes_count);
+}
 
-	for (auto i = static_cast<size_t>(m_input.gcount()); i < bytes_count; i++) {
-		pbuf[i] = 0;
+#if !defined(_WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
+bool GenericRXDevice::openFile()
+{
+	if (m_fd >= 0) {
+		return true;
 	}
 
-	std::fstream tmpFile("iio_emu_tmp_file.txt", std::ios::out | std::ios::binary);
-	copyFileData(m_input, tmpFile);
-	tmpFile.close();
+	m_fd = ::open(m_filePath.c_str(), O_RDONLY | O_CLOEXEC);
+	return m_fd >= 0;
+}
 
-	m_input.close();
-	m_input.open(m_filePath, std::ofstream::out | std::ofstream::trunc);
-	m_input.close();
+size_t GenericRXDevice::readFile(char* buf, size_t len)
+{
+	// unlike a mapping, pread can't fault when another writer truncates the file during the copy
+	ssize_t ret;
+	do {
+		ret = pread(m_fd, buf, len, static_cast<off_t>(m_position));
+	} while (ret < 0 && errno == EINTR);
 
-	tmpFile.open("iio_emu_tmp_file.txt", std::ios::in | std::ios::binary);
-	m_input.open(m_filePath, std::ios::out | std::ios::binary);
-	tmpFile.seekg(std::ios::beg);
+	if (ret < 0) {
+		Logger::log(IIO_EMU_ERROR, {"Cannot read ", m_filePath, ": ", strerror(errno)});
+		return 0;
+	}
+	if (ret == 0 && m_position > 0) {
+		struct stat st = {};
+		if (fstat(m_fd, &st) == 0 && static_cast<size_t>(st.st_size) < m_position) {
+			// truncated by another writer, the playback starts over
+			m_position = 0;
+			return readFile(buf, len);
+		}
+	}
 
-	copyFileData(tmpFile, m_input);
+	m_position += static_cast<size_t>(ret);
+	return static_cast<size_t>(ret);
+}
+#else
+bool GenericRXDevice::openFile()
+{
+	if (!m_input.is_open()) {
+		m_input.open(m_filePath, std::ios::in | std::ios::binary);
+	}
+	return m_input.is_open();
+}
 
-	m_input.close();
-	tmpFile.close();
-	std::remove("iio_emu_tmp_file.txt");
+size_t GenericRXDevice::readFile(char* buf, size_t len)
+{
+	// the file can grow between the buffers, when a TX device appends to it
+	m_input.clear();
+	m_input.seekg(0, std::ios::end);
+	if (m_input.tellg() < static_cast<std::streamoff>(m_position)) {
+		// truncated by another writer, the playback starts over
+		m_position = 0;
+	}
 
-	return static_cast<ssize_t>(bytes_count);
+	m_input.seekg(static_cast<std::streamoff>(m_position));
+	m_input.read(buf, static_cast<std::streamsize>(len));
+	auto count = static_cast<size_t>(m_input.gcount());
+	m_position += count;
+	return count;
 }
+#endif
 
 void GenericRXDevice::connectDevice(unsigned short channel_in, AbstractDeviceOut* deviceOut, unsigned short channel_out)
 {
+	// the whole buffer is looped back, not single channels
 	UNUSED(channel_in);
-	UNUSED(deviceOut);
 	UNUSED(channel_out);
+	m_loopback = deviceOut;
 }
 
 ssize_t GenericRXDevice::transfer_dev_to_mem(size_t bytes_count)
@@ -108,16 +186,6 @@ ssize_t GenericRXDevice::transfer_dev_to_mem(size_t bytes_count)
 	return 0;
 }
 
-void GenericRXDevice::copyFileData(std::fstream& in, std::fstream& out)
-{
-	char buf[BUF_SIZE];
-
-	do {
-		in.read(&buf[0], BUF_SIZE);
-		out.write(&buf[0], in.gcount());
-	} while (in.gcount() > 0);
-}
-
 int32_t GenericRXDevice::open_dev(size_t sample_size, uint32_t mask, bool cyclic)
 {
 	UNUSED(sample_size);
@@ -49,7 +49,8 @@ namespace iio_emu {
 class GenericRXDevice : public AbstractDeviceIn
 {
 public:
-	GenericRXDevice(const char* device_id, const char* filePath);
+	// a cyclic device starts the file over once it reaches its end
+	GenericRXDevice(const char* device_id, const char* filePath, bool cyclic = false);
 	~GenericRXDevice() override;
 	ssize_t read_dev(char* pbuf, size_t offset, size_t bytes_count) override;
 	void connectDevice(unsigned short channel_in, AbstractDeviceOut* deviceOut,
@@ -63,11 +64,24 @@ public:
 	int32_t cancel_buffer() override;
 
 private:
-	void copyFileData(std::fstream& in, std::fstream& out);
+	bool openFile();
+	// copies the samples at the current position, returns 0 at the end of the file
+	size_t readFile(char* buf, size_t len);
 
-	std::fstream m_input;
 	const std::string m_filePath;
+	// the buffers continue where the previous one ended
+	size_t m_position;
+	bool m_cyclic;
 	uint32_t m_mask;
+	// when connected, the samples come from this TX device instead of the file
+	AbstractDeviceOut* m_loopback;
+
+#if !defined(_WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
+	// the file is opened once, the buffers are copied from the page cache with pread
+	int m_fd;
+#else
+	std::ifstream m_input;
+#endif
 };
 } // namespace iio_emu
 
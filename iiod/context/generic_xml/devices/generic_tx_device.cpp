@@ -42,55 +42,180 @@
 #include "utils/logger.hpp"
 #include "utils/utility.hpp"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#if !defined(_WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// samples waiting to be written to the file
+#define WRITE_BEHIND_SIZE (16 * 1024 * 1024)
+// disk space reserved at once past the end of the file
+#define RESERVE_SIZE (4 * 1024 * 1024)
+// samples waiting to be read by the RX device of a loopback
+#define LOOPBACK_SIZE (16 * 1024 * 1024)
+
 using namespace iio_emu;
 
 GenericTXDevice::GenericTXDevice(const char* device_id, const char* filePath)
 	: m_filePath(filePath)
+	, m_mask(0)
+	, m_dropping(false)
+	, m_cyclic(false)
+	, m_cyclicReady(false)
+	, m_cyclicIndex(0)
+	, m_head(0)
+	, m_tail(0)
+	, m_stop(false)
+	, m_error(0)
+#if !defined(_WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
+	, m_fd(-1)
+	, m_size(0)
+	, m_reserved(0)
+#endif
 {
 	auto tmpArray = new char[strlen(device_id) + 1];
-	strncpy(tmpArray, device_id, strlen(device_id));
+	memcpy(tmpArray, device_id, strlen(device_id) + 1);
 	m_device_id = tmpArray;
 }
 
-GenericTXDevice::~GenericTXDevice() { delete[] m_device_id; }
+GenericTXDevice::~GenericTXDevice()
+{
+	if (m_flusher.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_dataReady.notify_one();
+		// the thread writes what is left before returning
+		m_flusher.join();
+	}
+#if !defined(_WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
+	if (m_fd >= 0) {
+		releaseReserve();
+		::close(m_fd);
+	}
+#endif
+	delete[] m_device_id;
+}
 
 ssize_t GenericTXDevice::write_dev(const char* buf, size_t offset, size_t bytes_count)
 {
 	UNUSED(offset);
 
-	m_output = std::fstream(m_filePath, std::ios::app | std::ios::binary);
-	if (!m_output) {
-		Logger::log(IIO_EMU_FATAL, {"Invalid file path: ", m_filePath});
-		return -1;
+	if (m_cyclic) {
+		// a new push replaces the resident buffer
+		if (m_cyclicReady) {
+			m_cyclicBuffer.clear();
+			m_cyclicReady = false;
+			m_cyclicIndex = 0;
+		}
+		m_cyclicBuffer.insert(m_cyclicBuffer.end(), buf, buf + bytes_count);
+	} else if (m_loopback && !m_dropping && !m_loopback->push(buf, bytes_count)) {
+		// the RX device reads at its own pace, a buffer that doesn't fit is lost like on a real loopback
+		m_loopback->discard();
+		m_dropping = true;
+	}
+	if (m_filePath.empty()) {
+		return static_cast<ssize_t>(bytes_count);
 	}
 
-	m_output.write(buf, static_cast<long>(bytes_count));
-	m_output.close();
+	int32_t ret = start();
+	if (ret < 0) {
+		return ret;
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (m_error) {
+		ret = -m_error;
+		m_error = 0;
+		return ret;
+	}
+
+	// only waits for the file when the ring is full
+	size_t count = 0;
+	while (count < bytes_count) {
+		m_spaceReady.wait(lock, [this] { return m_head - m_tail < WRITE_BEHIND_SIZE; });
+
+		size_t index = m_head % WRITE_BEHIND_SIZE;
+		size_t chunk = std::min(bytes_count - count, WRITE_BEHIND_SIZE - (m_head - m_tail));
+		chunk = std::min(chunk, WRITE_BEHIND_SIZE - index);
+		memcpy(m_buffer.get() + index, buf + count, chunk);
+		m_head += chunk;
+		count += chunk;
+		m_dataReady.notify_one();
+	}
 
 	return static_cast<ssize_t>(bytes_count);
 }
 
 ssize_t GenericTXDevice::transfer_mem_to_dev(size_t bytes_count)
 {
-	UNUSED(bytes_count);
+	// called once the whole buffer was written
+	if (m_cyclic) {
+		m_cyclicReady = true;
+	} else if (m_dropping) {
+		Logger::log(IIO_EMU_WARNING, {m_device_id, ": loopback full, a buffer of ", std::to_string(bytes_count),
+					      " bytes was dropped"});
+		m_dropping = false;
+	} else if (m_loopback) {
+		m_loopback->commit();
+	}
 	return 0;
 }
 
 void GenericTXDevice::transfer_samples_to_RX_device(char* buf, size_t samples_count)
 {
-	UNUSED(buf);
-	UNUSED(samples_count);
+	if (m_cyclic) {
+		std::lock_guard<std::mutex> lock(getMutex());
+		if (m_cyclic) {
+			size_t count = 0;
+			while (m_cyclicReady && !m_cyclicBuffer.empty() && count < samples_count) {
+				size_t chunk = std::min(samples_count - count, m_cyclicBuffer.size() - m_cyclicIndex);
+				memcpy(buf + count, m_cyclicBuffer.data() + m_cyclicIndex, chunk);
+				count += chunk;
+				m_cyclicIndex = (m_cyclicIndex + chunk) % m_cyclicBuffer.size();
+			}
+			memset(buf + count, 0, samples_count - count);
+			return;
+		}
+	}
+
+	size_t count = m_loopback ? m_loopback->pop(buf, samples_count) : 0;
+	memset(buf + count, 0, samples_count - count);
+}
+
+bool GenericTXDevice::enableLoopback()
+{
+	if (m_loopback) {
+		return false;
+	}
+	m_loopback.reset(new LoopbackRing(LOOPBACK_SIZE));
+	return true;
 }
 
 int32_t GenericTXDevice::open_dev(size_t sample_size, uint32_t mask, bool cyclic)
 {
 	UNUSED(sample_size);
-	UNUSED(cyclic);
 	m_mask = mask;
-	return 0;
+	// the chunks of a buffer interrupted by the previous close are not looped back
+	if (m_loopback) {
+		m_loopback->discard();
+	}
+	m_dropping = false;
+	releaseCyclicBuffer();
+	m_cyclic = cyclic;
+	return m_filePath.empty() ? 0 : start();
 }
 
-int32_t GenericTXDevice::close_dev() { return 0; }
+int32_t GenericTXDevice::close_dev()
+{
+	releaseCyclicBuffer();
+	return flush();
+}
 
 int32_t GenericTXDevice::set_buffers_count(uint32_t buffers_count)
 {
@@ -104,4 +229,148 @@ int32_t GenericTXDevice::get_mask(uint32_t* mask)
 	return 0;
 }
 
-int32_t GenericTXDevice::cancel_buffer() { return 0; }
+int32_t GenericTXDevice::cancel_buffer()
+{
+	releaseCyclicBuffer();
+	return flush();
+}
+
+void GenericTXDevice::releaseCyclicBuffer()
+{
+	m_cyclic = false;
+	m_cyclicReady = false;
+	m_cyclicIndex = 0;
+	std::vector<char>().swap(m_cyclicBuffer);
+}
+
+int32_t GenericTXDevice::start()
+{
+	if (m_flusher.joinable()) {
+		return 0;
+	}
+
+#if !defined(_WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
+	m_fd = ::open(m_filePath.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+	if (m_fd < 0) {
+		int err = errno;
+		Logger::log(IIO_EMU_FATAL, {"Invalid file path: ", m_filePath});
+		return -err;
+	}
+
+	struct stat st;
+	m_size = (fstat(m_fd, &st) == 0) ? static_cast<uint64_t>(st.st_size) : 0;
+#else
+	m_output.open(m_filePath, std::ios::app | std::ios::binary);
+	if (!m_output) {
+		Logger::log(IIO_EMU_FATAL, {"Invalid file path: ", m_filePath});
+		return -ENOENT;
+	}
+#endif
+
+	m_buffer.reset(new char[WRITE_BEHIND_SIZE]);
+	m_flusher = std::thread(&GenericTXDevice::drain, this);
+	return 0;
+}
+
+int32_t GenericTXDevice::flush()
+{
+	if (!m_flusher.joinable()) {
+		return 0;
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_spaceReady.wait(lock, [this] { return m_head == m_tail; });
+	// the flush thread is idle until the next push, which waits for the lock
+	releaseReserve();
+
+	int32_t ret = -m_error;
+	m_error = 0;
+	return ret;
+}
+
+void GenericTXDevice::drain()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true) {
+		m_dataReady.wait(lock, [this] { return m_head != m_tail || m_stop; });
+		if (m_head == m_tail) {
+			break;
+		}
+
+		// the writer doesn't touch the pending range, it is written without the lock
+		size_t index = m_tail % WRITE_BEHIND_SIZE;
+		size_t chunk = std::min(m_head - m_tail, WRITE_BEHIND_SIZE - index);
+		lock.unlock();
+		bool written = writeFile(m_buffer.get() + index, chunk);
+		int err = errno;
+		lock.lock();
+
+		if (!written && !m_error) {
+			Logger::log(IIO_EMU_ERROR, {"Could not write to ", m_filePath, ": ", strerror(err)});
+			m_error = err ? err : EIO;
+		}
+		m_tail += chunk;
+		m_spaceReady.notify_all();
+	}
+}
+
+#if !defined(_WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
+bool GenericTXDevice::writeFile(const char* buf, size_t len)
+{
+#if defined(__linux__)
+	// reserving the blocks ahead keeps the file contiguous, the size only changes with the writes
+	if (m_reserved != UINT64_MAX && m_size + len > m_reserved) {
+		off_t size = static_cast<off_t>(std::max<size_t>(len, RESERVE_SIZE));
+		if (fallocate(m_fd, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(m_size), size) == 0) {
+			m_reserved = m_size + static_cast<uint64_t>(size);
+		} else {
+			// not supported by the file system
+			m_reserved = UINT64_MAX;
+		}
+	}
+#endif
+
+	while (len > 0) {
+		ssize_t ret = ::write(m_fd, buf, len);
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		buf += ret;
+		len -= static_cast<size_t>(ret);
+		m_size += static_cast<uint64_t>(ret);
+	}
+	return true;
+}
+
+void GenericTXDevice::releaseReserve()
+{
+#if defined(__linux__)
+	if (m_reserved == 0 || m_reserved == UINT64_MAX) {
+		return;
+	}
+
+	// truncating the file to its own size frees the blocks past its end, it may have been truncated meanwhile
+	struct stat st;
+	if (fstat(m_fd, &st) == 0) {
+		m_size = static_cast<uint64_t>(st.st_size);
+		if (ftruncate(m_fd, st.st_size) < 0) {
+			Logger::log(IIO_EMU_WARNING, {"Could not release the space reserved for ", m_filePath});
+		}
+	}
+	m_reserved = 0;
+#endif
+}
+#else
+bool GenericTXDevice::writeFile(const char* buf, size_t len)
+{
+	m_output.write(buf, static_cast<std::streamsize>(len));
+	m_output.flush();
+	errno = m_output ? 0 : EIO;
+	return static_cast<bool>(m_output);
+}
+
+void GenericTXDevice::releaseReserve() {}
+#endif
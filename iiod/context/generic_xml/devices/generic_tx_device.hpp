@@ -41,14 +41,22 @@
 #define IIO_EMU_GENERIC_TX_DEVICE_HPP
 
 #include "iiod/devices/abstract_device_out.hpp"
+#include "loopback_ring.hpp"
 
+#include <atomic>
+#include <condition_variable>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace iio_emu {
 
 class GenericTXDevice : public AbstractDeviceOut
 {
 public:
+	// an empty file path only feeds the loopback
 	GenericTXDevice(const char* device_id, const char* filePath);
 	~GenericTXDevice() override;
 	int32_t open_dev(size_t sample_size, uint32_t mask, bool cyclic) override;
@@ -59,12 +67,64 @@ public:
 	ssize_t write_dev(const char* buf, size_t offset, size_t bytes_count) override;
 	ssize_t transfer_mem_to_dev(size_t bytes_count) override;
 
+	/*
+	 * copies samples_count bytes of the looped back samples, zero padded when not enough were pushed.
+	 * A cyclic buffer is repeated from where the previous call stopped.
+	 */
 	void transfer_samples_to_RX_device(char* buf, size_t samples_count) override;
 
+	// the pushed samples are also queued for an RX device, returns false if already enabled
+	bool enableLoopback();
+
 private:
-	std::fstream m_output;
+	// opens the file and starts the flush thread, if not done yet
+	int32_t start();
+	// waits until the buffered samples reached the file
+	int32_t flush();
+	void drain();
+	bool writeFile(const char* buf, size_t len);
+	// gives back the disk space reserved past the end of the file
+	void releaseReserve();
+	void releaseCyclicBuffer();
+
 	const std::string m_filePath;
 	uint32_t m_mask;
+
+	std::unique_ptr<LoopbackRing> m_loopback;
+	// the current buffer didn't fit in the loopback, it is dropped whole
+	bool m_dropping;
+
+	// a cyclic buffer is pushed once and stays resident until the device is closed,
+	// the RX device reads it under the device mutex
+	std::atomic<bool> m_cyclic;
+	std::vector<char> m_cyclicBuffer;
+	// set once the whole buffer was pushed
+	bool m_cyclicReady;
+	size_t m_cyclicIndex;
+
+	// the samples are copied to a ring and written to the file by the flush thread,
+	// m_head and m_tail are free running
+	std::unique_ptr<char[]> m_buffer;
+	size_t m_head;
+	size_t m_tail;
+	bool m_stop;
+	// errno of the last failed write, reported by the next call
+	int m_error;
+	std::mutex m_mutex;
+	std::condition_variable m_dataReady;
+	std::condition_variable m_spaceReady;
+	std::thread m_flusher;
+
+#if !defined(_WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
+	// the file stays open for the whole run
+	int m_fd;
+	// end of the file, as written by the flush thread
+	uint64_t m_size;
+	// end of the range reserved on disk ahead of the writes
+	uint64_t m_reserved;
+#else
+	std::ofstream m_output;
+#endif
 };
 } // namespace iio_emu
 #endif // IIO_EMU_GENERIC_TX_DEVICE_HPP
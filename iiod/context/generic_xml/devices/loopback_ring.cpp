@@ -0,0 +1,93 @@
+/*
+ * ADIBSD License
+ *
+ * Copyright (c) 2021 Analog Devices Inc.
+ * All rights reserved.
+ *
+ * This file is part of iio-emu
+ * (see http://www.github.com/analogdevicesinc/iio-emu).
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *     - Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     - Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     - Neither the name of Analog Devices, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *     - The use of this software may or may not infringe the patent rights
+ *       of one or more patent holders.  This license does not release you
+ *       from the requirement that you obtain separate licenses from these
+ *       patent holders to use this software.
+ *     - Use of the software either in source or binary form, must be run
+ *       on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.
+ *
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, INTELLECTUAL PROPERTY
+ * RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "loopback_ring.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace iio_emu;
+
+LoopbackRing::LoopbackRing(size_t size)
+	: m_data(new char[size])
+	, m_size(size)
+	, m_staged(0)
+	, m_head(0)
+	, m_tail(0)
+{}
+
+bool LoopbackRing::push(const char* buf, size_t len)
+{
+	size_t head = m_head.load(std::memory_order_relaxed) + m_staged;
+	size_t tail = m_tail.load(std::memory_order_acquire);
+	if (len > m_size - (head - tail)) {
+		return false;
+	}
+
+	size_t index = head % m_size;
+	size_t chunk = std::min(len, m_size - index);
+	memcpy(m_data.get() + index, buf, chunk);
+	memcpy(m_data.get(), buf + chunk, len - chunk);
+	m_staged += len;
+	return true;
+}
+
+void LoopbackRing::commit()
+{
+	// the bytes are visible to the consumer before the new head
+	m_head.store(m_head.load(std::memory_order_relaxed) + m_staged, std::memory_order_release);
+	m_staged = 0;
+}
+
+void LoopbackRing::discard() { m_staged = 0; }
+
+size_t LoopbackRing::pop(char* buf, size_t len)
+{
+	size_t tail = m_tail.load(std::memory_order_relaxed);
+	size_t head = m_head.load(std::memory_order_acquire);
+	len = std::min(len, head - tail);
+
+	size_t index = tail % m_size;
+	size_t chunk = std::min(len, m_size - index);
+	memcpy(buf, m_data.get() + index, chunk);
+	memcpy(buf + chunk, m_data.get(), len - chunk);
+
+	m_tail.store(tail + len, std::memory_order_release);
+	return len;
+}
@@ -0,0 +1,83 @@
+/*
+ * ADIBSD License
+ *
+ * Copyright (c) 2021 Analog Devices Inc.
+ * All rights reserved.
+ *
+ * This file is part of iio-emu
+ * (see http://www.github.com/analogdevicesinc/iio-emu).
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *     - Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     - Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     - Neither the name of Analog Devices, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *     - The use of this software may or may not infringe the patent rights
+ *       of one or more patent holders.  This license does not release you
+ *       from the requirement that you obtain separate licenses from these
+ *       patent holders to use this software.
+ *     - Use of the software either in source or binary form, must be run
+ *       on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.
+ *
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, INTELLECTUAL PROPERTY
+ * RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IIO_EMU_LOOPBACK_RING_HPP
+#define IIO_EMU_LOOPBACK_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace iio_emu {
+
+/*
+ * Single producer, single consumer byte ring between a TX device and the RX
+ * device that loops it back. Each side is used under its own device mutex, so
+ * the two sides only share the free running head and tail counters.
+ * The producer stages the chunks of a buffer and publishes the whole buffer
+ * at once, the consumer never sees a partial buffer.
+ */
+class LoopbackRing
+{
+public:
+	explicit LoopbackRing(size_t size);
+
+	// stages the bytes after the ones already staged, returns false when they don't fit
+	bool push(const char* buf, size_t len);
+	// makes the staged bytes available to the consumer
+	void commit();
+	void discard();
+	// copies as many bytes as are available, returns the count
+	size_t pop(char* buf, size_t len);
+
+private:
+	std::unique_ptr<char[]> m_data;
+	size_t m_size;
+	// bytes written after the head, only used by the producer
+	size_t m_staged;
+
+	// on separate cache lines, each one is written by one side only
+	char m_padding[64];
+	std::atomic<size_t> m_head;
+	char m_headPadding[64];
+	std::atomic<size_t> m_tail;
+};
+} // namespace iio_emu
+
+#endif // IIO_EMU_LOOPBACK_RING_HPP
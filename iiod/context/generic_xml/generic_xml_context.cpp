@@ -42,60 +42,174 @@
 #include "iiod/devices/abstract_device.hpp"
 #include "iiod/devices/abstract_device_in.hpp"
 #include "iiod/devices/abstract_device_out.hpp"
+#include "iiod/devices/shm_ring.hpp"
+#include "iiod/ops/session.hpp"
 #include "iiod/ops/tinyiiod_ops_wrapper.hpp"
 #include "networking/abstract_socket.hpp"
-#include "utils/attr_ops_xml.hpp"
+#include "utils/attr_ops.hpp"
+#include "utils/attr_store.hpp"
+#include "utils/context_image.hpp"
+#include "utils/xml_utils.hpp"
 #include "utils/input_parser.hpp"
+#include "utils/logger.hpp"
 #include "utils/network_ops.hpp"
 #include "utils/utility.hpp"
 
 #include <iiod/context/generic_xml/devices/generic_rx_device.hpp>
 #include <iiod/context/generic_xml/devices/generic_tx_device.hpp>
-#include <libxml/tree.h>
+#include <algorithm>
+#include <cstring>
+#include <libxml/parser.h>
+#include <mutex>
+#include <sstream>
 
 using namespace iio_emu;
 
+constexpr const char* SHM_RING_ATTR = "shm_ring";
+constexpr uint32_t SHM_RING_BLOCK_SIZE = 1024 * 1024;
+constexpr uint32_t SHM_RING_BLOCK_COUNT = 8;
+constexpr uint64_t SHM_RING_MAX_SIZE = 1024 * 1024 * 1024;
+
+bool GenericXmlContext::dtdValidation = false;
+
+static ContextImage* openContextImage(ContextImage* image, int ret)
+{
+	if (ret < 0) {
+		delete image;
+		return nullptr;
+	}
+	return image;
+}
+
+static bool hasXmlAttr(const char* tag, const char* end, const char* name, const char* value)
+{
+	std::string attr = std::string(" ") + name + "=\"" + value + "\"";
+	return std::search(tag, end, attr.begin(), attr.end()) != end;
+}
+
+// the channels without attributes are only listed by the client XML
+static bool hasXmlChannel(const char* xml, const char* device_id, const char* channel, bool ch_out)
+{
+	for (const char* device = strstr(xml, "<device "); device != nullptr; device = strstr(device + 1, "<device ")) {
+		const char* deviceTagEnd = strchr(device, '>');
+		if (deviceTagEnd == nullptr || !hasXmlAttr(device, deviceTagEnd, "id", device_id)) {
+			continue;
+		}
+
+		const char* deviceEnd = strstr(deviceTagEnd, "</device>");
+		if (deviceTagEnd[-1] == '/' || deviceEnd == nullptr) {
+			return false;
+		}
+		for (const char* tag = strstr(deviceTagEnd, "<channel "); tag != nullptr && tag < deviceEnd;
+		     tag = strstr(tag + 1, "<channel ")) {
+			const char* tagEnd = strchr(tag, '>');
+			if (tagEnd != nullptr && hasXmlAttr(tag, tagEnd, "id", channel) &&
+			    hasXmlAttr(tag, tagEnd, "type", ch_out ? "output" : "input")) {
+				return true;
+			}
+		}
+		return false;
+	}
+	return false;
+}
+
 GenericXmlContext::GenericXmlContext(std::vector<const char*>& args)
 {
 	auto xmlPath = InputParser::getXMLPath(args);
 	auto devices = InputParser::getDevices(args);
 
 	// TODO: check xmlPath
-	m_doc = xmlReadFile(xmlPath, nullptr, XML_PARSE_DTDVALID);
-	m_xml_size = iio_emu::getXml(m_doc, &m_ctx_xml);
+	auto image = new ContextImage();
+	if (ContextImage::isImage(xmlPath)) {
+		image = openContextImage(image, image->open(xmlPath));
+	} else {
+		if (dtdValidation && iio_emu::validateXml(xmlPath) < 0) {
+			Logger::log(IIO_EMU_WARNING, {xmlPath, " is not valid against its DTD"});
+		}
+		image = openContextImage(image, image->load(xmlPath));
+	}
+	loadImage(image);
 
 	for (const auto& devInfo : devices) {
 		if (isScanChannel(devInfo.first.c_str())) {
+			std::string filePath = devInfo.second;
+			bool cyclic = InputParser::takeCyclicOption(filePath);
+
 			AbstractDevice* dev;
 			if (isOutputChannel(devInfo.first.c_str())) {
-				dev = new GenericTXDevice(devInfo.first.c_str(), devInfo.second.c_str());
+				if (cyclic) {
+					Logger::log(IIO_EMU_WARNING, {"The cyclic option only applies to RX devices"});
+				}
+				dev = new GenericTXDevice(devInfo.first.c_str(), filePath.c_str());
 			} else {
-				dev = new GenericRXDevice(devInfo.first.c_str(), devInfo.second.c_str());
+				dev = new GenericRXDevice(devInfo.first.c_str(), filePath.c_str(), cyclic);
 			}
 			addDevice(dev);
 		}
 	}
 
+	for (const auto& loopback : InputParser::getLoopbacks(args)) {
+		addLoopback(loopback.first.c_str(), loopback.second.c_str());
+	}
+
 	assignBasicOps();
 }
 
+void GenericXmlContext::addLoopback(const char* rx_id, const char* tx_id)
+{
+	if (!isInputChannel(rx_id) || !isOutputChannel(tx_id)) {
+		Logger::log(IIO_EMU_ERROR, {"Invalid loopback ", rx_id, "<", tx_id, ": expected an RX and a TX device"});
+		return;
+	}
+
+	// a TX device linked to a file keeps writing it, the file is a tap of the loopback
+	auto tx = dynamic_cast<GenericTXDevice*>(getDevice(tx_id));
+	if (!tx) {
+		tx = new GenericTXDevice(tx_id, "");
+		addDevice(tx);
+	}
+	if (!tx->enableLoopback()) {
+		Logger::log(IIO_EMU_ERROR, {tx_id, " is already looped back"});
+		return;
+	}
+
+	auto rx = dynamic_cast<GenericRXDevice*>(getDevice(rx_id));
+	if (!rx) {
+		rx = new GenericRXDevice(rx_id, "");
+		addDevice(rx);
+	} else {
+		Logger::log(IIO_EMU_WARNING, {rx_id, " reads from ", tx_id, " instead of its file"});
+	}
+	rx->connectDevice(0, tx, 0);
+}
+
 GenericXmlContext::GenericXmlContext(const char* file, int fileSize)
 {
-	m_doc = xmlReadMemory(file, fileSize, nullptr, nullptr, XML_PARSE_DTDVALID);
-	m_xml_size = iio_emu::getXml(m_doc, &m_ctx_xml);
+	auto size = static_cast<size_t>(fileSize);
+	if (dtdValidation && iio_emu::validateXml(file, size) < 0) {
+		Logger::log(IIO_EMU_WARNING, {"The context XML is not valid against its DTD"});
+	}
+
+	auto image = new ContextImage();
+	loadImage(openContextImage(image, image->load(file, size)));
 }
 
+GenericXmlContext::GenericXmlContext(ContextImage* image) { loadImage(image); }
+
 GenericXmlContext::~GenericXmlContext()
 {
 	delete m_iiodOps;
 	m_iiodOps = nullptr;
 
-	xmlFreeDoc(m_doc);
 	xmlCleanupParser();
-	m_doc = nullptr;
 
-	delete m_ctx_xml;
+	// both XMLs are part of the image
 	m_ctx_xml = nullptr;
+	m_ctx_zxml = nullptr;
+
+	for (auto ring : m_shmRings) {
+		delete ring.second;
+	}
 
 	for (auto dev : m_devices) {
 		if (dev) {
@@ -103,6 +217,12 @@ GenericXmlContext::~GenericXmlContext()
 			dev = nullptr;
 		}
 	}
+
+	// the devices read their configuration from the store, which uses the image tables
+	delete m_store;
+	m_store = nullptr;
+	delete m_image;
+	m_image = nullptr;
 }
 
 AbstractDevice* GenericXmlContext::getDevice(const char* device_id) const
@@ -120,72 +240,128 @@ AbstractDevice* GenericXmlContext::getDevice(const char* device_id) const
 
 void GenericXmlContext::addDevice(AbstractDevice* dev) { m_devices.push_back(dev); }
 
-ssize_t GenericXmlContext::readData(char* buf, size_t len) { return socket_read(m_current_socket, buf, len); }
+ssize_t GenericXmlContext::readData(Session& session, char* buf, size_t len)
+{
+	return socket_read(session, buf, len);
+}
 
-ssize_t GenericXmlContext::writeData(const char* buf, size_t len)
+ssize_t GenericXmlContext::writeData(Session& session, const char* buf, size_t len)
 {
-	m_current_socket->write(buf, len);
+	session.getSocket()->write(buf, len);
 	return 0;
 }
 
-ssize_t GenericXmlContext::readLine(char* buf, size_t len)
+ssize_t GenericXmlContext::readLine(Session& session, char* buf, size_t len)
 {
-	UNUSED(buf);
-	UNUSED(len);
-	return -ENOENT;
+	if (len == 0) {
+		return -EINVAL;
+	}
+
+	/*
+	 * the line ends at '\n', without the '\r' of a CRLF ending. The '\n' has to be consumed,
+	 * it would otherwise be read as the first byte of a WRITE value or WRITEBUF payload.
+	 * Empty lines are skipped.
+	 */
+	AbstractSocket* socket = session.getSocket();
+	size_t length = 0;
+	while (true) {
+		char c;
+		if (socket->getData(1, &c) != 1) {
+			return -EIO;
+		}
+		if (c == '\n') {
+			if (length > 0 && buf[length - 1] == '\r') {
+				length--;
+			}
+			if (length > 0) {
+				break;
+			}
+			continue;
+		}
+		if (length == len - 1) {
+			return -EIO;
+		}
+		buf[length++] = c;
+	}
+	buf[length] = '\0';
+
+	/*
+	 * tinyiiod doesn't know ZPRINT, the command is answered here and the
+	 * error keeps tinyiiod from parsing the line
+	 */
+	if (m_ctx_zxml && !strcmp(buf, "ZPRINT")) {
+		writeCompressedXml(session);
+		return -EAGAIN;
+	}
+	if (!strncmp(buf, "READ ", 5) && readAllAttrs(session, buf + 5)) {
+		return -EAGAIN;
+	}
+	return static_cast<ssize_t>(length);
 }
 
 ssize_t GenericXmlContext::openInstance() { return -ENOENT; }
 
 ssize_t GenericXmlContext::closeInstance() { return -ENOENT; }
 
-ssize_t GenericXmlContext::readAttr(const char* device_id, const char* attr, char* buf, size_t len,
+ssize_t GenericXmlContext::readAttr(Session& session, const char* device_id, const char* attr, char* buf, size_t len,
 				    enum iio_attr_type type)
 {
-	return iio_emu::read_device_attr(m_doc, device_id, attr, buf, len, type);
+	if (ShmRing::enabled && type == IIO_ATTR_TYPE_BUFFER && !strcmp(attr, SHM_RING_ATTR)) {
+		return readShmRing(session, device_id, buf, len);
+	}
+	return iio_emu::read_device_attr(m_store, device_id, attr, buf, len, type);
 }
 
-ssize_t GenericXmlContext::writeAttr(const char* device_id, const char* attr, const char* buf, size_t len,
-				     enum iio_attr_type type)
+ssize_t GenericXmlContext::writeAttr(Session& session, const char* device_id, const char* attr, const char* buf,
+				     size_t len, enum iio_attr_type type)
 {
-	return iio_emu::write_dev_attr(m_doc, device_id, attr, buf, len, type);
+	if (ShmRing::enabled && type == IIO_ATTR_TYPE_BUFFER && !strcmp(attr, SHM_RING_ATTR)) {
+		return writeShmRing(session, device_id, buf, len);
+	}
+	return iio_emu::write_dev_attr(m_store, device_id, attr, buf, len, type);
 }
 
 ssize_t GenericXmlContext::chReadAttr(const char* device_id, const char* channel, bool ch_out, const char* attr,
 				      char* buf, size_t len)
 {
-	return iio_emu::read_channel_attr(m_doc, device_id, channel, ch_out, attr, buf, len);
+	return iio_emu::read_channel_attr(m_store, device_id, channel, ch_out, attr, buf, len);
 }
 
 ssize_t GenericXmlContext::chWriteAttr(const char* device_id, const char* channel, bool ch_out, const char* attr,
 				       const char* buf, size_t len)
 {
-	return iio_emu::write_channel_attr(m_doc, device_id, channel, ch_out, attr, buf, len);
+	return iio_emu::write_channel_attr(m_store, device_id, channel, ch_out, attr, buf, len);
 }
 
-int32_t GenericXmlContext::openDev(const char* device, size_t sample_size, uint32_t mask, bool cyclic)
+int32_t GenericXmlContext::openDev(Session& session, const char* device, size_t sample_size, uint32_t mask, bool cyclic)
 {
-	AbstractDevice* abstractDevice = getDevice(device);
+	AbstractDevice* abstractDevice = getDevice(session, device);
 	if (abstractDevice) {
-		abstractDevice->setDescriptor(m_current_socket->getDescriptor());
+		stopShmRing(abstractDevice);
+		std::lock_guard<std::mutex> lock(abstractDevice->getMutex());
+		abstractDevice->setDescriptor(session.getSocket()->getDescriptor());
 		return abstractDevice->open_dev(sample_size, mask, cyclic);
 	}
 	return -ENOENT;
 }
 
-int32_t GenericXmlContext::closeDev(const char* device)
+int32_t GenericXmlContext::closeDev(Session& session, const char* device)
 {
-	AbstractDevice* abstractDevice = getDevice(device);
+	AbstractDevice* abstractDevice = getDevice(session, device);
 	if (abstractDevice) {
+		stopShmRing(abstractDevice);
+		std::lock_guard<std::mutex> lock(abstractDevice->getMutex());
+		abstractDevice->setDescriptor(-1);
 		return abstractDevice->close_dev();
 	}
 	return -ENOENT;
 }
 
-ssize_t GenericXmlContext::transferDevToMem(const char* device, size_t bytes_count)
+ssize_t GenericXmlContext::transferDevToMem(Session& session, const char* device, size_t bytes_count)
 {
-	AbstractDevice* abstractDevice = getDevice(device);
+	AbstractDevice* abstractDevice = getDevice(session, device);
 	if (abstractDevice) {
+		std::lock_guard<std::mutex> lock(abstractDevice->getMutex());
 		auto* deviceIn = dynamic_cast<AbstractDeviceIn*>(abstractDevice);
 		if (deviceIn) {
 			return deviceIn->transfer_dev_to_mem(bytes_count);
@@ -194,10 +370,12 @@ ssize_t GenericXmlContext::transferDevToMem(const char* device, size_t bytes_cou
 	return -ENOENT;
 }
 
-ssize_t GenericXmlContext::readDev(const char* device, char* pbuf, size_t offset, size_t bytes_count)
+ssize_t GenericXmlContext::readDev(Session& session, const char* device, char* pbuf, size_t offset,
+				   size_t bytes_count)
 {
-	AbstractDevice* abstractDevice = getDevice(device);
+	AbstractDevice* abstractDevice = getDevice(session, device);
 	if (abstractDevice) {
+		std::lock_guard<std::mutex> lock(abstractDevice->getMutex());
 		auto* deviceIn = dynamic_cast<AbstractDeviceIn*>(abstractDevice);
 		if (deviceIn) {
 			return deviceIn->read_dev(pbuf, offset, bytes_count);
@@ -206,10 +384,11 @@ ssize_t GenericXmlContext::readDev(const char* device, char* pbuf, size_t offset
 	return -ENOENT;
 }
 
-ssize_t GenericXmlContext::transferMemToDev(const char* device, size_t bytes_count)
+ssize_t GenericXmlContext::transferMemToDev(Session& session, const char* device, size_t bytes_count)
 {
-	AbstractDevice* abstractDevice = getDevice(device);
+	AbstractDevice* abstractDevice = getDevice(session, device);
 	if (abstractDevice) {
+		std::lock_guard<std::mutex> lock(abstractDevice->getMutex());
 		auto* deviceOut = dynamic_cast<AbstractDeviceOut*>(abstractDevice);
 		if (deviceOut) {
 			return deviceOut->transfer_mem_to_dev(bytes_count);
@@ -218,10 +397,12 @@ ssize_t GenericXmlContext::transferMemToDev(const char* device, size_t bytes_cou
 	return -ENOENT;
 }
 
-ssize_t GenericXmlContext::writeDev(const char* device, const char* buf, size_t offset, size_t bytes_count)
+ssize_t GenericXmlContext::writeDev(Session& session, const char* device, const char* buf, size_t offset,
+				    size_t bytes_count)
 {
-	AbstractDevice* abstractDevice = getDevice(device);
+	AbstractDevice* abstractDevice = getDevice(session, device);
 	if (abstractDevice) {
+		std::lock_guard<std::mutex> lock(abstractDevice->getMutex());
 		auto* deviceOut = dynamic_cast<AbstractDeviceOut*>(abstractDevice);
 		if (deviceOut) {
 			return deviceOut->write_dev(buf, offset, bytes_count);
@@ -230,10 +411,11 @@ ssize_t GenericXmlContext::writeDev(const char* device, const char* buf, size_t
 	return -ENOENT;
 }
 
-int32_t GenericXmlContext::getMask(const char* device, uint32_t* mask)
+int32_t GenericXmlContext::getMask(Session& session, const char* device, uint32_t* mask)
 {
-	AbstractDevice* abstractDevice = getDevice(device);
+	AbstractDevice* abstractDevice = getDevice(session, device);
 	if (abstractDevice) {
+		std::lock_guard<std::mutex> lock(abstractDevice->getMutex());
 		return abstractDevice->get_mask(mask);
 	}
 	return -ENOENT;
@@ -263,15 +445,112 @@ int32_t GenericXmlContext::setTrigger(const char* device, const char* trigger, s
 	return -ENOENT;
 }
 
-int32_t GenericXmlContext::setBuffersCount(const char* device, uint32_t buffers_count)
+int32_t GenericXmlContext::setBuffersCount(Session& session, const char* device, uint32_t buffers_count)
 {
-	AbstractDevice* abstractDevice = getDevice(device);
+	AbstractDevice* abstractDevice = getDevice(session, device);
 	if (abstractDevice) {
+		std::lock_guard<std::mutex> lock(abstractDevice->getMutex());
 		return abstractDevice->set_buffers_count(buffers_count);
 	}
 	return -ENOENT;
 }
 
+void GenericXmlContext::loadImage(ContextImage* image)
+{
+	m_image = image;
+	if (m_image == nullptr) {
+		m_ctx_xml = nullptr;
+		m_xml_size = -ENOENT;
+		m_ctx_zxml = nullptr;
+		m_zxml_size = -ENOENT;
+		m_store = new AttrStore();
+		m_store->finishLoading();
+		return;
+	}
+
+	// the image is mapped read only, the XMLs are never written
+	const char* xml;
+	m_xml_size = m_image->getXml(&xml);
+	m_ctx_xml = const_cast<char*>(xml);
+	m_zxml_size = m_image->getCompressedXml(&xml);
+	m_ctx_zxml = m_zxml_size > 0 ? const_cast<char*>(xml) : nullptr;
+	m_store = new AttrStore(*m_image);
+
+	if (m_ctx_zxml) {
+		Logger::log(IIO_EMU_INFO, {"Context: ", std::to_string(m_store->size()), " attributes, ",
+					   std::to_string(m_xml_size), " bytes of XML, ", std::to_string(m_zxml_size),
+					   " compressed"});
+	} else {
+		Logger::log(IIO_EMU_INFO, {"Context: ", std::to_string(m_store->size()), " attributes, ",
+					   std::to_string(m_xml_size), " bytes of XML"});
+	}
+}
+
+void GenericXmlContext::writeCompressedXml(Session& session)
+{
+	AbstractSocket* socket = session.getSocket();
+
+	// same framing as PRINT: the length, the data and a line break
+	auto length = std::to_string(m_zxml_size) + "\n";
+	socket->write(length.c_str(), length.size());
+	socket->write(m_ctx_zxml, static_cast<size_t>(m_zxml_size));
+	socket->write("\n", 1);
+}
+
+/*
+ * The reads of all the attributes of a device, of its debug or buffer
+ * attributes or of a channel leave the attribute name out. They are
+ * answered here in one pass over the store, tinyiiod reads single
+ * attributes into a fixed size buffer. Returns false for the other reads.
+ */
+bool GenericXmlContext::readAllAttrs(Session& session, const char* args)
+{
+	std::istringstream stream(args);
+	std::vector<std::string> words;
+	std::string word;
+	while (words.size() < 4 && stream >> word) {
+		words.push_back(word);
+	}
+
+	bool device = words.size() == 1;
+	bool deviceSet = words.size() == 2 && (words[1] == "DEBUG" || words[1] == "BUFFER");
+	bool channel = words.size() == 3 && (words[1] == "INPUT" || words[1] == "OUTPUT");
+	if (!device && !deviceSet && !channel) {
+		return false;
+	}
+
+	std::string values;
+	ssize_t ret;
+	const char* device_id = words[0].c_str();
+	if (m_image == nullptr || m_image->getDeviceFlags(device_id) < 0) {
+		ret = -ENOENT;
+	} else if (channel) {
+		bool output = words[1] == "OUTPUT";
+		ret = read_channel_attrs(m_store, device_id, words[2].c_str(), output, &values);
+		// as for a single read, an unknown channel is an error and not an empty set
+		if (ret == 0 && !hasXmlChannel(m_ctx_xml, device_id, words[2].c_str(), output)) {
+			ret = -ENOENT;
+		}
+	} else {
+		enum iio_attr_type type = IIO_ATTR_TYPE_DEVICE;
+		if (deviceSet) {
+			type = words[1] == "DEBUG" ? IIO_ATTR_TYPE_DEBUG : IIO_ATTR_TYPE_BUFFER;
+		}
+		ret = read_device_attrs(m_store, device_id, &values, type);
+	}
+	Logger::log(IIO_EMU_DEBUG, {"Read all attributes: ", args});
+
+	// same framing as a single read: the length, then the data and a line break
+	AbstractSocket* socket = session.getSocket();
+	auto length = std::to_string(ret < 0 ? ret : static_cast<ssize_t>(values.size())) + "\n";
+	socket->write(length.c_str(), length.size());
+	if (ret >= 0 && !values.empty()) {
+		values.push_back('\n');
+		socket->write(values.data(), values.size());
+	}
+	return true;
+}
+
 ssize_t GenericXmlContext::getXml(char** outxml)
 {
 	if (!outxml) {
@@ -282,13 +561,24 @@ ssize_t GenericXmlContext::getXml(char** outxml)
 	return m_xml_size;
 }
 
-void GenericXmlContext::setCurrentSocket(AbstractSocket* socket) { m_current_socket = socket; }
-
-void GenericXmlContext::socketDisconnected(int fd)
+void GenericXmlContext::socketDisconnected(Session& session)
 {
-	AbstractDevice* abstractDevice = getDevice(fd);
-	if (abstractDevice) {
-		abstractDevice->cancel_buffer();
+	int fd = session.getSocket()->getDescriptor();
+
+	for (auto dev : session.getDevices()) {
+		{
+			std::lock_guard<std::mutex> lock(dev->getMutex());
+			if (dev->getDescriptor() != fd) {
+				continue;
+			}
+		}
+		// the ring producer takes the device mutex, stop it first
+		stopShmRing(dev);
+
+		std::lock_guard<std::mutex> lock(dev->getMutex());
+		if (dev->getDescriptor() == fd) {
+			dev->cancel_buffer();
+		}
 	}
 }
 
@@ -296,6 +586,7 @@ void GenericXmlContext::assignBasicOps()
 {
 	m_iiodOps->read = iio_emu::read;
 	m_iiodOps->write = iio_emu::write;
+	m_iiodOps->read_line = iio_emu::read_line;
 
 	m_iiodOps->read_attr = iio_emu::read_attr;
 	m_iiodOps->write_attr = iio_emu::write_attr;
@@ -350,69 +641,138 @@ void GenericXmlContext::assignAllOps()
 	m_iiodOps->get_xml = iio_emu::get_xml;
 }
 
-AbstractDevice* GenericXmlContext::getDevice(int fd)
+AbstractDevice* GenericXmlContext::getDevice(Session& session, const char* device_id) const
 {
-	AbstractDevice* device = nullptr;
-
-	for (auto dev : m_devices) {
-		if (dev->getDescriptor() == fd) {
-			device = dev;
-			break;
+	AbstractDevice* device = session.getDevice(device_id);
+	if (device == nullptr) {
+		device = getDevice(device_id);
+		if (device) {
+			session.addDevice(device);
 		}
 	}
 	return device;
 }
 
-bool GenericXmlContext::isScanChannel(const char* device_id)
+AbstractDeviceIn* GenericXmlContext::getOpenedDeviceIn(Session& session, const char* device_id) const
 {
-	xmlNode *root, *node_device, *node_channel, *node_attr;
+	AbstractDevice* abstractDevice = getDevice(session, device_id);
+	if (abstractDevice == nullptr) {
+		return nullptr;
+	}
 
-	root = xmlDocGetRootElement(m_doc);
-	if (root == nullptr) {
-		return false;
+	std::lock_guard<std::mutex> lock(abstractDevice->getMutex());
+	if (abstractDevice->getDescriptor() != session.getSocket()->getDescriptor()) {
+		return nullptr;
 	}
+	return dynamic_cast<AbstractDeviceIn*>(abstractDevice);
+}
 
-	node_device = getNode(root, "device", "id", device_id);
-	if (node_device == nullptr) {
-		return false;
+ssize_t GenericXmlContext::readShmRing(Session& session, const char* device_id, char* buf, size_t len)
+{
+	auto device = getOpenedDeviceIn(session, device_id);
+	if (device == nullptr) {
+		return -EBADF;
 	}
 
-	for (node_channel = node_device->children; node_channel; node_channel = node_channel->next) {
-		if (!strcmp(reinterpret_cast<const char*>(node_channel->name), "channel")) {
-			node_attr = getNode(node_channel, "scan-element");
-			if (node_attr) {
-				return true;
-			}
+	std::string path;
+	{
+		std::lock_guard<std::mutex> lock(m_shmMutex);
+		auto it = m_shmRings.find(device);
+		if (it != m_shmRings.end()) {
+			path = it->second->getPath();
 		}
 	}
 
-	return false;
+	if (path.empty()) {
+		int ret = startShmRing(device, SHM_RING_BLOCK_SIZE, SHM_RING_BLOCK_COUNT);
+		if (ret < 0) {
+			return ret;
+		}
+		return readShmRing(session, device_id, buf, len);
+	}
+
+	if (path.size() + 1 > len) {
+		return -ENOMEM;
+	}
+	memcpy(buf, path.c_str(), path.size() + 1);
+	return static_cast<ssize_t>(path.size() + 1);
 }
 
-bool GenericXmlContext::isOutputChannel(const char* device_id)
+ssize_t GenericXmlContext::writeShmRing(Session& session, const char* device_id, const char* buf, size_t len)
 {
-	if (!isScanChannel(device_id)) {
-		return false;
+	auto device = getOpenedDeviceIn(session, device_id);
+	if (device == nullptr) {
+		return -EBADF;
 	}
 
-	xmlNode *root, *node_device, *node_attr;
+	// "<block_size> <block_count>"
+	std::string value(buf, strnlen(buf, len));
+	char* end;
+	errno = 0;
+	unsigned long blockSize = strtoul(value.c_str(), &end, 10);
+	unsigned long blockCount = strtoul(end, &end, 10);
+	if (errno || *end != '\0' || blockSize == 0 || blockCount == 0 ||
+	    static_cast<uint64_t>(blockSize) * blockCount > SHM_RING_MAX_SIZE) {
+		return -EINVAL;
+	}
 
-	root = xmlDocGetRootElement(m_doc);
-	if (root == nullptr) {
-		return false;
+	int ret = startShmRing(device, static_cast<uint32_t>(blockSize), static_cast<uint32_t>(blockCount));
+	if (ret < 0) {
+		return ret;
+	}
+	return static_cast<ssize_t>(len);
+}
+
+int GenericXmlContext::startShmRing(AbstractDeviceIn* device, uint32_t blockSize, uint32_t blockCount)
+{
+	stopShmRing(device);
+
+	auto ring = new ShmRing(device, blockSize, blockCount);
+	int ret = ring->start();
+	if (ret < 0) {
+		Logger::log(IIO_EMU_ERROR, {"Cannot create the shared memory ring of ", device->getDeviceId()});
+		delete ring;
+		return ret;
 	}
 
-	node_device = getNode(root, "device", "id", device_id);
-	if (node_device == nullptr) {
+	std::lock_guard<std::mutex> lock(m_shmMutex);
+	m_shmRings[device] = ring;
+	return 0;
+}
+
+void GenericXmlContext::stopShmRing(AbstractDevice* device)
+{
+	ShmRing* ring = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_shmMutex);
+		auto it = m_shmRings.find(device);
+		if (it == m_shmRings.end()) {
+			return;
+		}
+		ring = it->second;
+		m_shmRings.erase(it);
+	}
+	// joins the producer, which may wait for the device mutex
+	delete ring;
+}
+
+bool GenericXmlContext::isScanChannel(const char* device_id)
+{
+	if (m_image == nullptr) {
 		return false;
 	}
 
-	node_attr = getNode(node_device, "channel", "type", "input");
-	if (node_attr == nullptr) {
-		return true;
+	int flags = m_image->getDeviceFlags(device_id);
+	return flags >= 0 && (flags & ContextImage::DEVICE_SCAN);
+}
+
+bool GenericXmlContext::isOutputChannel(const char* device_id)
+{
+	if (!isScanChannel(device_id)) {
+		return false;
 	}
 
-	return false;
+	return m_image->getDeviceFlags(device_id) & ContextImage::DEVICE_OUTPUT;
 }
 
 bool GenericXmlContext::isInputChannel(const char* device_id)
@@ -42,13 +42,17 @@
 
 #include "iiod/ops/abstract_ops.hpp"
 
+#include <map>
+#include <mutex>
 #include <vector>
 
-struct _xmlDoc;
-
 namespace iio_emu {
 
 class AbstractDevice;
+class AbstractDeviceIn;
+class AttrStore;
+class ContextImage;
+class ShmRing;
 
 class GenericXmlContext : public AbstractOps
 {
@@ -56,27 +60,32 @@ class GenericXmlContext : public AbstractOps
 public:
 	explicit GenericXmlContext(std::vector<const char*>& args);
 	GenericXmlContext(const char* file, int fileSize);
+	// takes ownership of the image, nullptr loads an empty context
+	explicit GenericXmlContext(ContextImage* image);
 	~GenericXmlContext() override;
 
 	AbstractDevice* getDevice(const char* device_id) const;
 	void addDevice(AbstractDevice* dev);
 
+	// enabled by the --validate option, the XML contexts are validated against their DTD before loading
+	static bool dtdValidation;
+
 public:
 	// interface implementation
-	ssize_t readData(char* buf, size_t len) override;
+	ssize_t readData(Session& session, char* buf, size_t len) override;
 
-	ssize_t writeData(const char* buf, size_t len) override;
+	ssize_t writeData(Session& session, const char* buf, size_t len) override;
 
-	ssize_t readLine(char* buf, size_t len) override;
+	ssize_t readLine(Session& session, char* buf, size_t len) override;
 
 	ssize_t openInstance() override;
 
 	ssize_t closeInstance() override;
 
-	ssize_t readAttr(const char* device_id, const char* attr, char* buf, size_t len,
+	ssize_t readAttr(Session& session, const char* device_id, const char* attr, char* buf, size_t len,
 			 enum iio_attr_type type) override;
 
-	ssize_t writeAttr(const char* device_id, const char* attr, const char* buf, size_t len,
+	ssize_t writeAttr(Session& session, const char* device_id, const char* attr, const char* buf, size_t len,
 			  enum iio_attr_type type) override;
 
 	ssize_t chReadAttr(const char* device_id, const char* channel, bool ch_out, const char* attr, char* buf,
@@ -85,35 +94,35 @@ public:
 	ssize_t chWriteAttr(const char* device_id, const char* channel, bool ch_out, const char* attr, const char* buf,
 			    size_t len) override;
 
-	int32_t openDev(const char* device, size_t sample_size, uint32_t mask, bool cyclic) override;
+	int32_t openDev(Session& session, const char* device, size_t sample_size, uint32_t mask, bool cyclic) override;
 
-	int32_t closeDev(const char* device) override;
+	int32_t closeDev(Session& session, const char* device) override;
 
-	ssize_t transferDevToMem(const char* device, size_t bytes_count) override;
-	ssize_t readDev(const char* device, char* pbuf, size_t offset, size_t bytes_count) override;
+	ssize_t transferDevToMem(Session& session, const char* device, size_t bytes_count) override;
+	ssize_t readDev(Session& session, const char* device, char* pbuf, size_t offset, size_t bytes_count) override;
 
-	ssize_t transferMemToDev(const char* device, size_t bytes_count) override;
-	ssize_t writeDev(const char* device, const char* buf, size_t offset, size_t bytes_count) override;
+	ssize_t transferMemToDev(Session& session, const char* device, size_t bytes_count) override;
+	ssize_t writeDev(Session& session, const char* device, const char* buf, size_t offset,
+			 size_t bytes_count) override;
 
-	int32_t getMask(const char* device, uint32_t* mask) override;
+	int32_t getMask(Session& session, const char* device, uint32_t* mask) override;
 
 	int32_t setTimeout(uint32_t timeout) override;
 
 	int32_t getTrigger(const char* device, char* trigger, size_t len) override;
 	int32_t setTrigger(const char* device, const char* trigger, size_t len) override;
 
-	int32_t setBuffersCount(const char* device, uint32_t buffers_count) override;
+	int32_t setBuffersCount(Session& session, const char* device, uint32_t buffers_count) override;
 
 	ssize_t getXml(char** outxml) override;
 
-	void setCurrentSocket(AbstractSocket* socket) override;
-	void socketDisconnected(int fd) override;
+	void socketDisconnected(Session& session) override;
 
 protected:
 	void assignBasicOps();
 	/*
 	 * use assignAllOps only if all methods are properly implemented (overridden)
-	 * not properly implemented methods by generic xml: readLine, openInstance, closeInstance, setTimeout
+	 * not properly implemented methods by generic xml: openInstance, closeInstance, setTimeout
 	 */
 	void assignAllOps();
 
@@ -121,18 +130,40 @@ protected:
 	bool isInputChannel(const char* device_id);
 
 protected:
-	struct _xmlDoc* m_doc;
-	AbstractSocket* m_current_socket;
+	// describes the context, the attribute values are served from m_store
+	ContextImage* m_image;
+	AttrStore* m_store;
 
 	std::vector<AbstractDevice*> m_devices;
 
 	char* m_ctx_xml;
 	ssize_t m_xml_size;
+	// served for ZPRINT, nullptr when the image has no compressed XML
+	char* m_ctx_zxml;
+	ssize_t m_zxml_size;
 
 private:
-	AbstractDevice* getDevice(int fd);
+	// resolves the device once per session
+	AbstractDevice* getDevice(Session& session, const char* device_id) const;
+
+	void loadImage(ContextImage* image);
+	void writeCompressedXml(Session& session);
+	bool readAllAttrs(Session& session, const char* args);
 
 	bool isScanChannel(const char* device_id);
+	// <rx_id><<tx_id> argument, the RX device reads what the TX device was pushed
+	void addLoopback(const char* rx_id, const char* tx_id);
+
+	// shared memory sample ring, the "shm_ring" buffer attribute
+	AbstractDeviceIn* getOpenedDeviceIn(Session& session, const char* device_id) const;
+	ssize_t readShmRing(Session& session, const char* device_id, char* buf, size_t len);
+	ssize_t writeShmRing(Session& session, const char* device_id, const char* buf, size_t len);
+	int startShmRing(AbstractDeviceIn* device, uint32_t blockSize, uint32_t blockCount);
+	void stopShmRing(AbstractDevice* device);
+
+private:
+	std::map<AbstractDevice*, ShmRing*> m_shmRings;
+	std::mutex m_shmMutex;
 };
 } // namespace iio_emu
 
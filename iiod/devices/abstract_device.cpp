@@ -46,3 +46,5 @@ const char* AbstractDevice::getDeviceId() const { return m_device_id; }
 int AbstractDevice::getDescriptor() const { return m_fd; }
 
 void AbstractDevice::setDescriptor(int fd) { m_fd = fd; }
+
+std::mutex& AbstractDevice::getMutex() { return m_mutex; }
@@ -40,6 +40,7 @@
 #ifndef IIO_EMU_DEVICE_HPP
 #define IIO_EMU_DEVICE_HPP
 
+#include <mutex>
 #include <tinyiiod/compat.h>
 
 namespace iio_emu {
@@ -60,9 +61,13 @@ public:
 	int getDescriptor() const;
 	void setDescriptor(int m_fd);
 
+	// serializes the buffer operations of clients handled by different threads
+	std::mutex& getMutex();
+
 protected:
 	const char* m_device_id;
-	int m_fd;
+	int m_fd = -1;
+	std::mutex m_mutex;
 };
 } // namespace iio_emu
 
@@ -0,0 +1,187 @@
+/*
+ * ADIBSD License
+ *
+ * Copyright (c) 2021 Analog Devices Inc.
+ * All rights reserved.
+ *
+ * This file is part of iio-emu
+ * (see http://www.github.com/analogdevicesinc/iio-emu).
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *     - Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     - Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     - Neither the name of Analog Devices, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *     - The use of this software may or may not infringe the patent rights
+ *       of one or more patent holders.  This license does not release you
+ *       from the requirement that you obtain separate licenses from these
+ *       patent holders to use this software.
+ *     - Use of the software either in source or binary form, must be run
+ *       on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.
+ *
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, INTELLECTUAL PROPERTY
+ * RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "shm_ring.hpp"
+#include "abstract_device_in.hpp"
+
+#include "utils/logger.hpp"
+
+#include <cerrno>
+#include <climits>
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+using namespace iio_emu;
+
+bool ShmRing::enabled = false;
+
+constexpr uint32_t DATA_OFFSET = 4096;
+// lets the producer notice stop requests while the client does not consume
+constexpr long WAIT_TIMEOUT_NS = 100000000;
+
+#if defined(__linux__)
+static void futexWait(uint32_t* addr, uint32_t value)
+{
+	struct timespec timeout = {0, WAIT_TIMEOUT_NS};
+	syscall(SYS_futex, addr, FUTEX_WAIT, value, &timeout, nullptr, 0);
+}
+
+static void futexWake(uint32_t* addr) { syscall(SYS_futex, addr, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0); }
+#endif
+
+ShmRing::ShmRing(AbstractDeviceIn* device, uint32_t blockSize, uint32_t blockCount)
+	: m_device(device)
+	, m_blockSize(blockSize)
+	, m_blockCount(blockCount)
+	, m_fd(-1)
+	, m_size(0)
+	, m_header(nullptr)
+	, m_stop(false)
+{}
+
+ShmRing::~ShmRing()
+{
+	stop();
+#if defined(__linux__)
+	if (m_header) {
+		munmap(m_header, m_size);
+	}
+	if (m_fd >= 0) {
+		::close(m_fd);
+	}
+#endif
+}
+
+int ShmRing::start()
+{
+#if defined(__linux__)
+	m_size = DATA_OFFSET + static_cast<size_t>(m_blockSize) * m_blockCount;
+
+	m_fd = memfd_create("iio-emu-ring", MFD_CLOEXEC);
+	if (m_fd < 0) {
+		return -errno;
+	}
+
+	if (ftruncate(m_fd, static_cast<off_t>(m_size)) < 0) {
+		return -errno;
+	}
+
+	void* addr = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+	if (addr == MAP_FAILED) {
+		return -errno;
+	}
+
+	m_header = static_cast<ShmRingHeader*>(addr);
+	m_header->magic = MAGIC;
+	m_header->version = VERSION;
+	m_header->blockSize = m_blockSize;
+	m_header->blockCount = m_blockCount;
+	m_header->dataOffset = DATA_OFFSET;
+	m_header->state = STATE_RUNNING;
+
+	m_producer = std::thread(&ShmRing::produce, this);
+	return 0;
+#else
+	return -ENOSYS;
+#endif
+}
+
+void ShmRing::stop()
+{
+	if (!m_producer.joinable()) {
+		return;
+	}
+
+	m_stop = true;
+#if defined(__linux__)
+	futexWake(&m_header->tail);
+#endif
+	m_producer.join();
+}
+
+std::string ShmRing::getPath() const
+{
+#if defined(__linux__)
+	return "/proc/" + std::to_string(getpid()) + "/fd/" + std::to_string(m_fd);
+#else
+	return "";
+#endif
+}
+
+void ShmRing::produce()
+{
+#if defined(__linux__)
+	auto data = reinterpret_cast<char*>(m_header) + DATA_OFFSET;
+	uint32_t head = 0;
+
+	while (!m_stop) {
+		uint32_t tail = __atomic_load_n(&m_header->tail, __ATOMIC_ACQUIRE);
+		if (head - tail >= m_blockCount) {
+			futexWait(&m_header->tail, tail);
+			continue;
+		}
+
+		char* block = data + static_cast<size_t>(head % m_blockCount) * m_blockSize;
+		ssize_t ret;
+		{
+			std::lock_guard<std::mutex> lock(m_device->getMutex());
+			ret = m_device->transfer_dev_to_mem(m_blockSize);
+			if (ret >= 0) {
+				ret = m_device->read_dev(block, 0, m_blockSize);
+			}
+		}
+		if (ret < 0) {
+			Logger::log(IIO_EMU_ERROR, {"Shared memory ring: device read failed"});
+			break;
+		}
+
+		head++;
+		__atomic_store_n(&m_header->head, head, __ATOMIC_RELEASE);
+		futexWake(&m_header->head);
+	}
+
+	__atomic_store_n(&m_header->state, static_cast<uint32_t>(STATE_STOPPED), __ATOMIC_RELEASE);
+	futexWake(&m_header->head);
+#endif
+}
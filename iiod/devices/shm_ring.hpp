@@ -0,0 +1,121 @@
+/*
+ * ADIBSD License
+ *
+ * Copyright (c) 2021 Analog Devices Inc.
+ * All rights reserved.
+ *
+ * This file is part of iio-emu
+ * (see http://www.github.com/analogdevicesinc/iio-emu).
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *     - Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     - Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     - Neither the name of Analog Devices, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *     - The use of this software may or may not infringe the patent rights
+ *       of one or more patent holders.  This license does not release you
+ *       from the requirement that you obtain separate licenses from these
+ *       patent holders to use this software.
+ *     - Use of the software either in source or binary form, must be run
+ *       on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.
+ *
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, INTELLECTUAL PROPERTY
+ * RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IIO_EMU_SHM_RING_HPP
+#define IIO_EMU_SHM_RING_HPP
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <tinyiiod/compat.h>
+
+namespace iio_emu {
+
+class AbstractDeviceIn;
+
+/*
+ * Layout of the shared memory region. The emulator fills the blocks in
+ * order and advances head, the client consumes them and advances tail.
+ * head and tail are free running counters, block i is at
+ * dataOffset + (i % blockCount) * blockSize. Both counters are futex words.
+ */
+struct ShmRingHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t blockSize;
+	uint32_t blockCount;
+	uint32_t dataOffset;
+	uint32_t state;
+	uint32_t reserved[10];
+
+	// on separate cache lines, each one is written by one side only
+	uint32_t head;
+	uint32_t headPadding[15];
+	uint32_t tail;
+	uint32_t tailPadding[15];
+};
+
+/*
+ * memfd backed ring of sample blocks filled from an input device, so a local
+ * client reads the samples without copies through the socket.
+ */
+class ShmRing
+{
+public:
+	static constexpr uint32_t MAGIC = 0x524d4549; // "IEMR"
+	static constexpr uint32_t VERSION = 1;
+
+	enum State
+	{
+		STATE_RUNNING = 0,
+		STATE_STOPPED = 1
+	};
+
+	ShmRing(AbstractDeviceIn* device, uint32_t blockSize, uint32_t blockCount);
+	~ShmRing();
+
+	// allocates the region and starts filling it
+	int start();
+	void stop();
+
+	// path the client opens to map the region
+	std::string getPath() const;
+
+	// enabled by the --shm option
+	static bool enabled;
+
+private:
+	void produce();
+
+private:
+	AbstractDeviceIn* m_device;
+	uint32_t m_blockSize;
+	uint32_t m_blockCount;
+
+	int m_fd;
+	size_t m_size;
+	ShmRingHeader* m_header;
+
+	std::atomic<bool> m_stop;
+	std::thread m_producer;
+};
+} // namespace iio_emu
+
+#endif // IIO_EMU_SHM_RING_HPP
@@ -39,15 +39,8 @@
 
 #include "abstract_ops.hpp"
 
-#include "tinyiiod_ops_wrapper.hpp"
-
 using namespace iio_emu;
 
-AbstractOps::AbstractOps()
-{
-	iio_emu::set_ops(this);
-
-	m_iiodOps = new struct tinyiiod_ops();
-}
+AbstractOps::AbstractOps() { m_iiodOps = new struct tinyiiod_ops(); }
 
 struct tinyiiod_ops* AbstractOps::getIIODOps() { return m_iiodOps; }
@@ -47,7 +47,7 @@ extern "C"
 
 namespace iio_emu {
 
-class AbstractSocket;
+class Session;
 
 class AbstractOps
 {
@@ -57,24 +57,23 @@ public:
 
 	virtual struct tinyiiod_ops* getIIODOps();
 
-	virtual void setCurrentSocket(AbstractSocket* socket) = 0;
-	virtual void socketDisconnected(int fd) = 0;
+	virtual void socketDisconnected(Session& session) = 0;
 
 	// tinyiiod ops:
 	// communication
-	virtual ssize_t readData(char* buf, size_t len) = 0;
-	virtual ssize_t writeData(const char* buf, size_t len) = 0;
-	virtual ssize_t readLine(char* buf, size_t len) = 0;
+	virtual ssize_t readData(Session& session, char* buf, size_t len) = 0;
+	virtual ssize_t writeData(Session& session, const char* buf, size_t len) = 0;
+	virtual ssize_t readLine(Session& session, char* buf, size_t len) = 0;
 
 	// open/close iiod instance
 	virtual ssize_t openInstance() = 0;
 	virtual ssize_t closeInstance() = 0;
 
 	// device, debug, buffer attributes
-	virtual ssize_t readAttr(const char* device_id, const char* attr, char* buf, size_t len,
+	virtual ssize_t readAttr(Session& session, const char* device_id, const char* attr, char* buf, size_t len,
 				 enum iio_attr_type type) = 0;
-	virtual ssize_t writeAttr(const char* device_id, const char* attr, const char* buf, size_t len,
-				  enum iio_attr_type type) = 0;
+	virtual ssize_t writeAttr(Session& session, const char* device_id, const char* attr, const char* buf,
+				  size_t len, enum iio_attr_type type) = 0;
 
 	// channel attributes
 	virtual ssize_t chReadAttr(const char* device_id, const char* channel, bool ch_out, const char* attr, char* buf,
@@ -83,28 +82,30 @@ public:
 				    const char* buf, size_t len) = 0;
 
 	// open/close device
-	virtual int32_t openDev(const char* device, size_t sample_size, uint32_t mask, bool cyclic) = 0;
-	virtual int32_t closeDev(const char* device) = 0;
+	virtual int32_t openDev(Session& session, const char* device, size_t sample_size, uint32_t mask, bool cyclic) = 0;
+	virtual int32_t closeDev(Session& session, const char* device) = 0;
 
 	// read device buffer
-	virtual ssize_t transferDevToMem(const char* device,
+	virtual ssize_t transferDevToMem(Session& session, const char* device,
 					 size_t bytes_count) = 0; // called at the end of transmission
-	virtual ssize_t readDev(const char* device, char* pbuf, size_t offset, size_t bytes_count) = 0;
+	virtual ssize_t readDev(Session& session, const char* device, char* pbuf, size_t offset,
+				size_t bytes_count) = 0;
 
 	// write device buffer
-	virtual ssize_t transferMemToDev(const char* device,
+	virtual ssize_t transferMemToDev(Session& session, const char* device,
 					 size_t bytes_count) = 0; // called at the end of transmission
-	virtual ssize_t writeDev(const char* device, const char* buf, size_t offset, size_t bytes_count) = 0;
+	virtual ssize_t writeDev(Session& session, const char* device, const char* buf, size_t offset,
+				 size_t bytes_count) = 0;
 
 	// the mask maps the enabled channels
-	virtual int32_t getMask(const char* device, uint32_t* mask) = 0;
+	virtual int32_t getMask(Session& session, const char* device, uint32_t* mask) = 0;
 
 	virtual int32_t setTimeout(uint32_t timeout) = 0;
 
 	virtual int32_t getTrigger(const char* device, char* trigger, size_t len) = 0;
 	virtual int32_t setTrigger(const char* device, const char* trigger, size_t len) = 0;
 
-	virtual int32_t setBuffersCount(const char* device, uint32_t buffers_count) = 0;
+	virtual int32_t setBuffersCount(Session& session, const char* device, uint32_t buffers_count) = 0;
 
 	virtual ssize_t getXml(char** outxml) = 0;
 
@@ -0,0 +1,91 @@
+/*
+ * ADIBSD License
+ *
+ * Copyright (c) 2021 Analog Devices Inc.
+ * All rights reserved.
+ *
+ * This file is part of iio-emu
+ * (see http://www.github.com/analogdevicesinc/iio-emu).
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *     - Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     - Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     - Neither the name of Analog Devices, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *     - The use of this software may or may not infringe the patent rights
+ *       of one or more patent holders.  This license does not release you
+ *       from the requirement that you obtain separate licenses from these
+ *       patent holders to use this software.
+ *     - Use of the software either in source or binary form, must be run
+ *       on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.
+ *
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, INTELLECTUAL PROPERTY
+ * RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "session.hpp"
+
+#include "abstract_ops.hpp"
+#include "iiod/devices/abstract_device.hpp"
+#include "networking/abstract_socket.hpp"
+#include "tinyiiod_ops_wrapper.hpp"
+
+using namespace iio_emu;
+
+Session::Session(AbstractOps* ops, AbstractSocket* socket)
+	: m_ops(ops)
+	, m_socket(socket)
+{
+	m_iiod = tinyiiod_create(m_ops->getIIODOps());
+}
+
+Session::~Session()
+{
+	if (m_iiod) {
+		tinyiiod_destroy(m_iiod);
+	}
+	delete m_socket;
+}
+
+int32_t Session::readCommand()
+{
+	Session* previous = current_session();
+
+	set_current_session(this);
+	auto ret = tinyiiod_read_command(m_iiod);
+	set_current_session(previous);
+
+	return ret;
+}
+
+AbstractOps* Session::getOps() const { return m_ops; }
+
+AbstractSocket* Session::getSocket() const { return m_socket; }
+
+AbstractDevice* Session::getDevice(const char* device_id) const
+{
+	for (auto dev : m_devices) {
+		if (!strcmp(dev->getDeviceId(), device_id)) {
+			return dev;
+		}
+	}
+	return nullptr;
+}
+
+void Session::addDevice(AbstractDevice* device) { m_devices.push_back(device); }
+
+const std::vector<AbstractDevice*>& Session::getDevices() const { return m_devices; }
@@ -0,0 +1,84 @@
+/*
+ * ADIBSD License
+ *
+ * Copyright (c) 2021 Analog Devices Inc.
+ * All rights reserved.
+ *
+ * This file is part of iio-emu
+ * (see http://www.github.com/analogdevicesinc/iio-emu).
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *     - Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     - Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     - Neither the name of Analog Devices, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *     - The use of this software may or may not infringe the patent rights
+ *       of one or more patent holders.  This license does not release you
+ *       from the requirement that you obtain separate licenses from these
+ *       patent holders to use this software.
+ *     - Use of the software either in source or binary form, must be run
+ *       on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.
+ *
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, INTELLECTUAL PROPERTY
+ * RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IIO_EMU_SESSION_HPP
+#define IIO_EMU_SESSION_HPP
+
+#include <tinyiiod/compat.h>
+#include <vector>
+
+struct tinyiiod;
+
+namespace iio_emu {
+
+class AbstractDevice;
+class AbstractOps;
+class AbstractSocket;
+
+/*
+ * State of a client connection. The session owns the socket and its own
+ * tinyiiod instance, so commands of different sessions can be executed at
+ * the same time by different threads.
+ */
+class Session
+{
+public:
+	Session(AbstractOps* ops, AbstractSocket* socket);
+	~Session();
+
+	// executes one command, the tinyiiod callbacks are routed to this session
+	int32_t readCommand();
+
+	AbstractOps* getOps() const;
+	AbstractSocket* getSocket() const;
+
+	// devices already resolved by this session
+	AbstractDevice* getDevice(const char* device_id) const;
+	void addDevice(AbstractDevice* device);
+	const std::vector<AbstractDevice*>& getDevices() const;
+
+private:
+	AbstractOps* m_ops;
+	AbstractSocket* m_socket;
+	struct tinyiiod* m_iiod;
+
+	std::vector<AbstractDevice*> m_devices;
+};
+} // namespace iio_emu
+#endif // IIO_EMU_SESSION_HPP
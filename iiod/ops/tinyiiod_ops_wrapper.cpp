@@ -40,203 +40,207 @@
 #include "tinyiiod_ops_wrapper.hpp"
 
 #include "abstract_ops.hpp"
+#include "session.hpp"
 #include "utils/logger.hpp"
 
 using namespace iio_emu;
 
-AbstractOps* g_ops;
+// tinyiiod callbacks have no user data, the session is kept per executing thread
+static thread_local Session* t_session = nullptr;
 
-void iio_emu::set_ops(iio_emu::AbstractOps* ops) { g_ops = ops; }
+void iio_emu::set_current_session(Session* session) { t_session = session; }
+
+Session* iio_emu::current_session() { return t_session; }
 
 ssize_t iio_emu::read(char* buf, size_t len)
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod read"});
-	return g_ops->readData(buf, len);
+	return t_session->getOps()->readData(*t_session, buf, len);
 }
 
 ssize_t iio_emu::write(const char* buf, size_t len)
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod write"});
-	return g_ops->writeData(buf, len);
+	return t_session->getOps()->writeData(*t_session, buf, len);
 }
 
 ssize_t iio_emu::read_line(char* buf, size_t len)
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod readline"});
-	return g_ops->readLine(buf, len);
+	return t_session->getOps()->readLine(*t_session, buf, len);
 }
 
 ssize_t iio_emu::open_instance()
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod open_instance"});
-	return g_ops->openInstance();
+	return t_session->getOps()->openInstance();
 }
 
 ssize_t iio_emu::close_instance()
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod close_instance"});
-	return g_ops->closeInstance();
+	return t_session->getOps()->closeInstance();
 }
 
 ssize_t iio_emu::read_attr(const char* device_id, const char* attr, char* buf, size_t len, enum iio_attr_type type)
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod read_attr: ", attr});
-	return g_ops->readAttr(device_id, attr, buf, len, type);
+	return t_session->getOps()->readAttr(*t_session, device_id, attr, buf, len, type);
 }
 
 ssize_t iio_emu::write_attr(const char* device_id, const char* attr, const char* buf, size_t len,
 			    enum iio_attr_type type)
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod write_attr: ", attr});
-	return g_ops->writeAttr(device_id, attr, buf, len, type);
+	return t_session->getOps()->writeAttr(*t_session, device_id, attr, buf, len, type);
 }
 
 ssize_t iio_emu::ch_read_attr(const char* device_id, const char* channel, bool ch_out, const char* attr, char* buf,
 			      size_t len)
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod ch_read_attr: ", attr});
-	return g_ops->chReadAttr(device_id, channel, ch_out, attr, buf, len);
+	return t_session->getOps()->chReadAttr(device_id, channel, ch_out, attr, buf, len);
 }
 
 ssize_t iio_emu::ch_write_attr(const char* device_id, const char* channel, bool ch_out, const char* attr,
 			       const char* buf, size_t len)
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod ch_write_attr: ", attr});
-	return g_ops->chWriteAttr(device_id, channel, ch_out, attr, buf, len);
+	return t_session->getOps()->chWriteAttr(device_id, channel, ch_out, attr, buf, len);
 }
 
 int32_t iio_emu::open(const char* device, size_t sample_size, uint32_t mask, bool cyclic)
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod open"});
-	return g_ops->openDev(device, sample_size, mask, cyclic);
+	return t_session->getOps()->openDev(*t_session, device, sample_size, mask, cyclic);
 }
 
 int32_t iio_emu::close(const char* device)
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod close"});
-	return g_ops->closeDev(device);
+	return t_session->getOps()->closeDev(*t_session, device);
 }
 
 ssize_t iio_emu::transfer_dev_to_mem(const char* device, size_t bytes_count)
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod transfer_dev_to_mem: ", std::to_string(bytes_count)});
-	return g_ops->transferDevToMem(device, bytes_count);
+	return t_session->getOps()->transferDevToMem(*t_session, device, bytes_count);
 }
 
 ssize_t iio_emu::read_data(const char* device, char* pbuf, size_t offset, size_t bytes_count)
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod read_data: ", std::to_string(bytes_count)});
-	return g_ops->readDev(device, pbuf, offset, bytes_count);
+	return t_session->getOps()->readDev(*t_session, device, pbuf, offset, bytes_count);
 }
 
 ssize_t iio_emu::transfer_mem_to_dev(const char* device, size_t bytes_count)
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod transfer_mem_to_dev: ", std::to_string(bytes_count)});
-	return g_ops->transferMemToDev(device, bytes_count);
+	return t_session->getOps()->transferMemToDev(*t_session, device, bytes_count);
 }
 
 ssize_t iio_emu::write_data(const char* device, const char* buf, size_t offset, size_t bytes_count)
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod write_data: ", std::to_string(bytes_count)});
-	return g_ops->writeDev(device, buf, offset, bytes_count);
+	return t_session->getOps()->writeDev(*t_session, device, buf, offset, bytes_count);
 }
 
 int32_t iio_emu::get_mask(const char* device, uint32_t* mask)
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod get_mask"});
-	return g_ops->getMask(device, mask);
+	return t_session->getOps()->getMask(*t_session, device, mask);
 }
 
 int32_t iio_emu::set_timeout(uint32_t timeout)
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod set_timeout: ", std::to_string(timeout)});
-	return g_ops->setTimeout(timeout);
+	return t_session->getOps()->setTimeout(timeout);
 }
 
 int32_t iio_emu::get_trigger(const char* device, char* trigger, size_t len)
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod get_trigger"});
 
-	return g_ops->getTrigger(device, trigger, len);
+	return t_session->getOps()->getTrigger(device, trigger, len);
 }
 
 int32_t iio_emu::set_trigger(const char* device, const char* trigger, size_t len)
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod set_trigger"});
-	return g_ops->setTrigger(device, trigger, len);
+	return t_session->getOps()->setTrigger(device, trigger, len);
 }
 
 int32_t iio_emu::set_buffers_count(const char* device, uint32_t buffers_count)
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod set_buffers_count: ", std::to_string(buffers_count)});
-	return g_ops->setBuffersCount(device, buffers_count);
+	return t_session->getOps()->setBuffersCount(*t_session, device, buffers_count);
 }
 
 ssize_t iio_emu::get_xml(char** outxml)
 {
-	if (g_ops == nullptr) {
+	if (t_session == nullptr) {
 		return -ENOENT;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Tinyiiod get_xml"});
-	return g_ops->getXml(outxml);
+	return t_session->getOps()->getXml(outxml);
 }
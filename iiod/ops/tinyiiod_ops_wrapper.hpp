@@ -44,9 +44,10 @@
 
 namespace iio_emu {
 
-class AbstractOps;
+class Session;
 
-void set_ops(iio_emu::AbstractOps* ops);
+void set_current_session(Session* session);
+Session* current_session();
 
 ssize_t read(char* buf, size_t len);
 ssize_t write(const char* buf, size_t len);
@@ -37,9 +37,12 @@
  * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "iiod/context/generic_xml/generic_xml_context.hpp"
+#include "iiod/devices/shm_ring.hpp"
 #include "networking/tcp_server.hpp"
 #include "utils/logger.hpp"
 
+#include <cstdlib>
 #include <iostream>
 #include <vector>
 extern "C"
@@ -49,6 +52,14 @@ extern "C"
 #include <inttypes.h> /* strtoimax */
 //default port value
 uint16_t port = 30431;
+//number of worker threads, 0 handles all clients on the main thread
+unsigned int workers = 0;
+//number of sockets listening on the port, each one with its own event loop thread
+unsigned int listeners = 1;
+//use the io_uring network backend when available
+bool ioUring = false;
+//path of the additional unix domain socket listener
+const char* unixPath = nullptr;
 
 uint16_t strToUint16T(const char *str) {
     char *end;
@@ -62,69 +73,126 @@ uint16_t strToUint16T(const char *str) {
     return static_cast<uint16_t>(val);
 }
 
+unsigned int strToCount(const char* str, const char* name)
+{
+	char* end;
+	errno = 0;
+	intmax_t val = strtoimax(str, &end, 10);
+	if (errno == ERANGE || val < 0 || val > UINT16_MAX || end == str || *end != '\0') {
+		iio_emu::Logger::log(iio_emu::IIO_EMU_INFO, {name, " value invalid ", str});
+		exit(1);
+	}
+	iio_emu::Logger::log(iio_emu::IIO_EMU_INFO, {name, ": ", str});
+	return static_cast<unsigned int>(val);
+}
+
 void handleOptions(int argc, char* argv[])
 {
 	int retOption = 0;
-	static struct option longOptions[] = {
-		{"help", no_argument, 0, 'h'}, {"list", no_argument, 0, 'l'}, {"verbose", no_argument, 0, 'v'}, {"port",  required_argument, 0, 'p'}};
-	retOption = getopt_long(argc, argv, "hlvp:", longOptions, NULL);
+	static struct option longOptions[] = {{"help", no_argument, 0, 'h'},
+					      {"list", no_argument, 0, 'l'},
+					      {"verbose", no_argument, 0, 'v'},
+					      {"port", required_argument, 0, 'p'},
+					      {"workers", required_argument, 0, 'w'},
+					      {"listeners", required_argument, 0, 'L'},
+					      {"io-uring", no_argument, 0, 'u'},
+					      {"unix", required_argument, 0, 'U'},
+					      {"shm", no_argument, 0, 's'},
+					      {"validate", no_argument, 0, 'V'},
+					      {0, 0, 0, 0}};
 
-	switch (retOption) {
-	case 'h':
-		iio_emu::Logger::log(iio_emu::IIO_EMU_INFO, {"Options:"});
-		iio_emu::Logger::log(iio_emu::IIO_EMU_INFO,
-				     {"-h, ", "--help;", "     Displays help on commandline options"});
-		iio_emu::Logger::log(iio_emu::IIO_EMU_INFO, {"-l, ", "--list;", "     Displays the calling options"});
-		iio_emu::Logger::log(iio_emu::IIO_EMU_INFO, {"-p, ", "--port;", "     Set TCP server port"});
-		iio_emu::Logger::log(iio_emu::IIO_EMU_INFO,
-				     {"-v, ", "--verbose;", "  Running in verbose mode; Must to be put at the end"});
-		exit(0);
-	case 'l':
-		iio_emu::Logger::log(iio_emu::IIO_EMU_INFO, {"iio-emu adalm2000"});
-		iio_emu::Logger::log(
-			iio_emu::IIO_EMU_INFO,
-			{"iio-emu generic <path_to_XML> <device_id>@<file_path>;", " <path_to_XML> is mandatory"});
-		exit(0);
-	case 'v':
-		iio_emu::Logger::verboseMode = true;
-		break;
-	case 'p':
-		if (optarg) {
-			port = strToUint16T(optarg);
-		} else {
-			iio_emu::Logger::log(iio_emu::IIO_EMU_INFO, {"Port value invalid "});
+	while ((retOption = getopt_long(argc, argv, "hlvp:w:L:uU:sV", longOptions, NULL)) != -1) {
+		switch (retOption) {
+		case 'h':
+			iio_emu::Logger::log(iio_emu::IIO_EMU_INFO, {"Options:"});
+			iio_emu::Logger::log(iio_emu::IIO_EMU_INFO,
+					     {"-h, ", "--help;", "     Displays help on commandline options"});
+			iio_emu::Logger::log(iio_emu::IIO_EMU_INFO,
+					     {"-l, ", "--list;", "     Displays the calling options"});
+			iio_emu::Logger::log(iio_emu::IIO_EMU_INFO, {"-p, ", "--port;", "     Set TCP server port"});
+			iio_emu::Logger::log(
+				iio_emu::IIO_EMU_INFO,
+				{"-w, ", "--workers;", "  Handle clients on a pool of worker threads (Linux only)"});
+			iio_emu::Logger::log(
+				iio_emu::IIO_EMU_INFO,
+				{"-L, ", "--listeners;", "Listen on the port with several event loop threads (Linux only)"});
+			iio_emu::Logger::log(iio_emu::IIO_EMU_INFO,
+					     {"-u, ", "--io-uring;", " Use the io_uring network backend (Linux only)"});
+			iio_emu::Logger::log(iio_emu::IIO_EMU_INFO,
+					     {"-U, ", "--unix;", "     Also listen on a unix domain socket"});
+			iio_emu::Logger::log(
+				iio_emu::IIO_EMU_INFO,
+				{"-s, ", "--shm;", "      Offer shared memory sample rings to local clients (Linux only)"});
+			iio_emu::Logger::log(iio_emu::IIO_EMU_INFO,
+					     {"-V, ", "--validate;", " Validate the context XML against its DTD"});
+			iio_emu::Logger::log(iio_emu::IIO_EMU_INFO,
+					     {"-v, ", "--verbose;", "  Running in verbose mode"});
+			exit(0);
+		case 'l':
+			iio_emu::Logger::log(iio_emu::IIO_EMU_INFO, {"iio-emu adalm2000"});
+			iio_emu::Logger::log(
+				iio_emu::IIO_EMU_INFO,
+				{"iio-emu generic <path_to_XML> <device_id>@<file_path>[:cyclic] <rx_device_id><<tx_device_id>;",
+				 " <path_to_XML> is mandatory, it can also be a compiled context image"});
 			exit(0);
+		case 'v':
+			iio_emu::Logger::verboseMode = true;
+			break;
+		case 'p':
+			if (optarg) {
+				port = strToUint16T(optarg);
+			} else {
+				iio_emu::Logger::log(iio_emu::IIO_EMU_INFO, {"Port value invalid "});
+				exit(0);
+			}
+			break;
+		case 'w':
+			workers = strToCount(optarg, "Workers");
+			break;
+		case 'L':
+			listeners = strToCount(optarg, "Listeners");
+			break;
+		case 'u':
+			ioUring = true;
+			break;
+		case 'U':
+			unixPath = optarg;
+			break;
+		case 's':
+			iio_emu::ShmRing::enabled = true;
+			break;
+		case 'V':
+			iio_emu::GenericXmlContext::dtdValidation = true;
+			break;
+		default:
+			exit(1);
 		}
-		break;
 	}
 }
 
 int main(int argc, char* argv[])
 {
 	handleOptions(argc, argv);
-	if (iio_emu::Logger::verboseMode) {
-		std::string lastArg = std::string(argv[argc - 1]);
-		bool isVerboseAtTheEnd = (lastArg.compare("--verbose") == 0 || lastArg.compare("-v") == 0);
-		if (!isVerboseAtTheEnd) {
-			iio_emu::Logger::log(iio_emu::IIO_EMU_FATAL, {"Verbose option must be put at the end!"});
-			exit(1);
-		}
-	}
-	if (argc < 2 || (argc == 2 && iio_emu::Logger::verboseMode)) {
+	// getopt_long moves the options in front of the positional arguments
+	if (optind >= argc) {
 		iio_emu::Logger::log(iio_emu::IIO_EMU_FATAL, {"No server type provided"});
 		exit(1);
 	}
-	iio_emu::Logger::log(iio_emu::IIO_EMU_INFO, {"Virtual device: ", argv[1]});
+	iio_emu::Logger::log(iio_emu::IIO_EMU_INFO, {"Virtual device: ", argv[optind]});
 
 	std::vector<const char*> args;
-	for (int i = 2; i < argc; i++) {
-		if (iio_emu::Logger::verboseMode && (i == (argc - 1))) {
-			break;
-		}
+	for (int i = optind + 1; i < argc; i++) {
 		args.push_back(argv[i]);
 	}
 
-	iio_emu::TcpServer server(argv[1], args);
+	iio_emu::TcpServer server(argv[optind], args);
+	server.setWorkersCount(workers);
+	server.setListenersCount(listeners);
+	server.setIoUring(ioUring);
+	if (unixPath) {
+		server.setUnixSocketPath(unixPath);
+	}
 	auto ret = server.start(port);
-	exit(ret);
+	// returning destroys the server, the TX devices write what they still buffer to their files
+	return ret ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -51,8 +51,24 @@ public:
 
 	virtual size_t getData(size_t len, char* buf) = 0;
 
+	/*
+	 * receives what the client sent without waiting, true once a whole command line is buffered.
+	 * Reading that command only waits for the payload that follows the line.
+	 */
+	virtual bool receiveCommand() = 0;
+
+	// a whole command line is already buffered, consumed by the next getData() calls
+	virtual bool hasPendingCommand() const = 0;
+
+	// the data may be queued until flush() is called
 	virtual void write(const char* buf, size_t len) = 0;
 
+	// sends the queued data, called once the response of a command is complete
+	virtual void flush() = 0;
+
+	// written data that couldn't be sent yet without blocking
+	virtual bool hasQueuedData() const = 0;
+
 	virtual bool disconnected() const = 0;
 
 	virtual int getDescriptor() const = 0;
@@ -0,0 +1,182 @@
+/*
+ * ADIBSD License
+ *
+ * Copyright (c) 2021 Analog Devices Inc.
+ * All rights reserved.
+ *
+ * This file is part of iio-emu
+ * (see http://www.github.com/analogdevicesinc/iio-emu).
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *     - Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     - Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     - Neither the name of Analog Devices, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *     - The use of this software may or may not infringe the patent rights
+ *       of one or more patent holders.  This license does not release you
+ *       from the requirement that you obtain separate licenses from these
+ *       patent holders to use this software.
+ *     - Use of the software either in source or binary form, must be run
+ *       on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.
+ *
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, INTELLECTUAL PROPERTY
+ * RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if defined(__linux__)
+
+#include "network_epoll.hpp"
+
+#include "utils/logger.hpp"
+
+#include <cerrno>
+#include <unistd.h>
+
+using namespace iio_emu;
+
+constexpr int MAX_EVENTS = 64;
+
+NetworkEpoll::NetworkEpoll(bool oneShot)
+	: m_epollFd(-1)
+	, m_clientFlags(oneShot ? static_cast<uint32_t>(EPOLLONESHOT) : 0)
+	, m_events(MAX_EVENTS)
+{
+	m_activeConnections.reserve(MAX_EVENTS);
+}
+
+NetworkEpoll::~NetworkEpoll()
+{
+	if (m_epollFd >= 0) {
+		::close(m_epollFd);
+	}
+}
+
+int NetworkEpoll::close()
+{
+	if (m_epollFd >= 0) {
+		::close(m_epollFd);
+		m_epollFd = -1;
+	}
+	return NetworkUnix::close();
+}
+
+int NetworkEpoll::listen(int backlog)
+{
+	int ret = NetworkUnix::listen(backlog);
+	if (ret < 0) {
+		return ret;
+	}
+
+	m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+	if (m_epollFd < 0) {
+		Logger::log(IIO_EMU_ERROR, {"Failed epoll creation"});
+		close();
+		return -1;
+	}
+
+	for (auto fd : {m_listenSocket, m_unixListenSocket, m_wakeFd}) {
+		if (fd < 0) {
+			continue;
+		}
+
+		struct epoll_event event = {};
+		event.events = EPOLLIN;
+		event.data.fd = fd;
+		if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+			Logger::log(IIO_EMU_ERROR, {"Failed epoll listen socket registration"});
+			close();
+			return -1;
+		}
+	}
+	return 0;
+}
+
+void NetworkEpoll::acceptConnections(int listenSocket)
+{
+	int ret, new_socket;
+
+	// the listen socket is non-blocking, drain the whole accept queue
+	while (true) {
+		ret = this->accept(listenSocket, &new_socket);
+		if (ret == -EAGAIN) {
+			return;
+		}
+		if (ret < 0) {
+			Logger::log(IIO_EMU_ERROR, {"Failed socket setup: ", std::to_string(new_socket)});
+			::close(new_socket);
+			continue;
+		}
+
+		struct epoll_event event = {};
+		event.events = EPOLLIN | m_clientFlags;
+		event.data.fd = new_socket;
+		if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, new_socket, &event) < 0) {
+			Logger::log(IIO_EMU_ERROR, {"Failed epoll socket registration: ", std::to_string(new_socket)});
+			::close(new_socket);
+			continue;
+		}
+		Logger::log(IIO_EMU_DEBUG, {"Epoll new socket: ", std::to_string(new_socket)});
+	}
+}
+
+int NetworkEpoll::checkForNewConnections()
+{
+	int total;
+
+	m_activeConnections.clear();
+
+	total = epoll_wait(m_epollFd, m_events.data(), static_cast<int>(m_events.size()), -1);
+	if (total < 0) {
+		if (errno == EINTR) {
+			return 0;
+		}
+		close();
+		return -1;
+	}
+
+	for (int i = 0; i < total; i++) {
+		int fd = m_events.at(static_cast<size_t>(i)).data.fd;
+		if (fd == m_wakeFd) {
+			clearWakeUp();
+		} else if (fd == m_listenSocket || fd == m_unixListenSocket) {
+			acceptConnections(fd);
+		} else {
+			m_activeConnections.push_back(fd);
+		}
+	}
+	return 0;
+}
+
+const std::vector<int>& NetworkEpoll::getActiveConnections() { return m_activeConnections; }
+
+void NetworkEpoll::disconnectSocket(int socket)
+{
+	Logger::log(IIO_EMU_DEBUG, {"Disconnect socket: ", std::to_string(socket)});
+	epoll_ctl(m_epollFd, EPOLL_CTL_DEL, socket, nullptr);
+}
+
+void NetworkEpoll::watchSocket(int socket, bool writable)
+{
+	struct epoll_event event = {};
+	event.events = (writable ? EPOLLOUT : EPOLLIN) | m_clientFlags;
+	event.data.fd = socket;
+	if (epoll_ctl(m_epollFd, EPOLL_CTL_MOD, socket, &event) < 0) {
+		Logger::log(IIO_EMU_ERROR, {"Failed epoll socket rearm: ", std::to_string(socket)});
+	}
+}
+
+#endif
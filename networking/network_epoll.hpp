@@ -0,0 +1,85 @@
+/*
+ * ADIBSD License
+ *
+ * Copyright (c) 2021 Analog Devices Inc.
+ * All rights reserved.
+ *
+ * This file is part of iio-emu
+ * (see http://www.github.com/analogdevicesinc/iio-emu).
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *     - Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     - Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     - Neither the name of Analog Devices, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *     - The use of this software may or may not infringe the patent rights
+ *       of one or more patent holders.  This license does not release you
+ *       from the requirement that you obtain separate licenses from these
+ *       patent holders to use this software.
+ *     - Use of the software either in source or binary form, must be run
+ *       on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.
+ *
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, INTELLECTUAL PROPERTY
+ * RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IIO_EMU_NETWORK_EPOLL_HPP
+#define IIO_EMU_NETWORK_EPOLL_HPP
+
+#include "network_unix.hpp"
+
+#include <sys/epoll.h>
+#include <vector>
+
+namespace iio_emu {
+
+/*
+ * Linux event loop backend. Client sockets are registered once in the epoll
+ * interest list, so a wakeup only costs the number of ready descriptors and
+ * is not limited by FD_SETSIZE.
+ * In one shot mode a client is reported only once, until watchSocket() is
+ * called for it; this lets other threads process the client's command.
+ */
+class NetworkEpoll : public NetworkUnix
+{
+public:
+	explicit NetworkEpoll(bool oneShot = false);
+	~NetworkEpoll() override;
+
+	int close() override;
+
+	int listen(int backlog) override;
+
+	int checkForNewConnections() override;
+
+	const std::vector<int>& getActiveConnections() override;
+
+	void disconnectSocket(int socket) override;
+
+	// thread safe, also rearms the socket in one shot mode
+	void watchSocket(int socket, bool writable) override;
+
+private:
+	void acceptConnections(int listenSocket);
+
+private:
+	int m_epollFd;
+	uint32_t m_clientFlags;
+	std::vector<struct epoll_event> m_events;
+};
+} // namespace iio_emu
+#endif // IIO_EMU_NETWORK_EPOLL_HPP
@@ -45,6 +45,8 @@
 
 namespace iio_emu {
 
+class AbstractSocket;
+
 class NetworkInterface
 {
 public:
@@ -54,15 +56,33 @@ public:
 
 	virtual int close() = 0;
 
+	// lets several listeners bind the same port, the kernel balances the new connections between them
+	virtual int setReusePort() = 0;
+
 	virtual int bind(uint16_t port) = 0;
 
+	// additional listener on a unix domain socket, for the clients on the same host
+	virtual int bindUnix(const char* path) = 0;
+
 	virtual int listen(int backlog) = 0;
 
 	virtual int checkForNewConnections() = 0;
 
-	virtual std::vector<int> getActiveConnections() = 0;
+	// makes a waiting checkForNewConnections() return, can be called from any thread
+	virtual void wakeUp() = 0;
+
+	virtual const std::vector<int>& getActiveConnections() = 0;
 
 	virtual void disconnectSocket(int socket) = 0;
+
+	/*
+	 * selects if the client is reported as active when it has data to be
+	 * read, or when it can receive the data queued for it
+	 */
+	virtual void watchSocket(int socket, bool writable) = 0;
+
+	// creates the socket used to communicate with an accepted client
+	virtual AbstractSocket* createSocket(int socket) = 0;
 };
 } // namespace iio_emu
 
@@ -40,20 +40,30 @@
 #if !defined(_WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
 
 #include "network_unix.hpp"
+#include "socket_unix.hpp"
 
 #include "utils/logger.hpp"
 
 #include <algorithm>
 #include <cerrno>
+#include <cstring>
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 using namespace iio_emu;
 
-NetworkUnix::NetworkUnix() { m_address = new struct sockaddr_in; }
+NetworkUnix::NetworkUnix()
+	: m_unixListenSocket(-1)
+	, m_wakeFd(-1)
+	, m_wakeWriteFd(-1)
+{
+	m_address = new struct sockaddr_in;
+}
 
 NetworkUnix::~NetworkUnix() { delete m_address; }
 
@@ -85,6 +95,20 @@ int NetworkUnix::open()
 
 int NetworkUnix::close()
 {
+	if (m_wakeFd >= 0) {
+		::close(m_wakeFd);
+		::close(m_wakeWriteFd);
+		m_wakeFd = -1;
+		m_wakeWriteFd = -1;
+	}
+
+	if (m_unixListenSocket >= 0) {
+		Logger::log(IIO_EMU_DEBUG, {"Close unix socket"});
+		::close(m_unixListenSocket);
+		unlink(m_unixPath.c_str());
+		m_unixListenSocket = -1;
+	}
+
 	if (m_listenSocket <= 0) {
 		return -1;
 	}
@@ -94,6 +118,23 @@ int NetworkUnix::close()
 	return 0;
 }
 
+int NetworkUnix::setReusePort()
+{
+#if defined(SO_REUSEPORT)
+	int yes = 1;
+
+	Logger::log(IIO_EMU_DEBUG, {"Set socket reuseport"});
+	if (setsockopt(m_listenSocket, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)) < 0) {
+		Logger::log(IIO_EMU_ERROR, {"Failed socket set reuseport"});
+		return -1;
+	}
+	return 0;
+#else
+	Logger::log(IIO_EMU_ERROR, {"SO_REUSEPORT is not supported"});
+	return -1;
+#endif
+}
+
 int NetworkUnix::bind(uint16_t port)
 {
 	if (m_listenSocket <= 0) {
@@ -115,6 +156,49 @@ int NetworkUnix::bind(uint16_t port)
 	return 0;
 }
 
+int NetworkUnix::bindUnix(const char* path)
+{
+	struct sockaddr_un address = {};
+	struct stat info = {};
+
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		Logger::log(IIO_EMU_ERROR, {"Unix socket path too long: ", path});
+		return -1;
+	}
+
+	m_unixListenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m_unixListenSocket < 0) {
+		Logger::log(IIO_EMU_ERROR, {"Failed unix socket creation"});
+		return -1;
+	}
+	Logger::log(IIO_EMU_DEBUG, {"Open unix socket: ", std::to_string(m_unixListenSocket)});
+
+	if (fcntl(m_unixListenSocket, F_SETFL, O_NONBLOCK) < 0) {
+		Logger::log(IIO_EMU_ERROR, {"Failed unix socket set nonblock"});
+		::close(m_unixListenSocket);
+		m_unixListenSocket = -1;
+		return -1;
+	}
+
+	// the socket file left by a previous run is replaced, other files are not touched
+	if (lstat(path, &info) == 0 && S_ISSOCK(info.st_mode)) {
+		unlink(path);
+	}
+
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+
+	Logger::log(IIO_EMU_DEBUG, {"Bind unix socket: ", path});
+	if (::bind(m_unixListenSocket, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0) {
+		Logger::log(IIO_EMU_ERROR, {"Failed unix socket bind"});
+		::close(m_unixListenSocket);
+		m_unixListenSocket = -1;
+		return -1;
+	}
+	m_unixPath = path;
+	return 0;
+}
+
 int NetworkUnix::listen(int backlog)
 {
 	if (m_listenSocket <= 0) {
@@ -127,24 +211,56 @@ int NetworkUnix::listen(int backlog)
 		close();
 		return -1;
 	}
+
+	if (m_unixListenSocket >= 0 && ::listen(m_unixListenSocket, backlog) < 0) {
+		Logger::log(IIO_EMU_ERROR, {"Failed unix socket listen"});
+		close();
+		return -1;
+	}
+
+	int wakePipe[2];
+	if (pipe(wakePipe) < 0) {
+		Logger::log(IIO_EMU_ERROR, {"Failed wake up pipe creation"});
+		close();
+		return -1;
+	}
+	m_wakeFd = wakePipe[0];
+	m_wakeWriteFd = wakePipe[1];
+	fcntl(m_wakeFd, F_SETFL, O_NONBLOCK);
+	fcntl(m_wakeWriteFd, F_SETFL, O_NONBLOCK);
 	return 0;
 }
 
-int NetworkUnix::accept(int* clientSocket)
+int NetworkUnix::accept(int listenSocket, int* clientSocket)
 {
-	if (m_listenSocket <= 0) {
+	if (listenSocket <= 0) {
 		return -1;
 	}
 
 	socklen_t addrlen = sizeof(*m_address);
 	int ret, yes = 1, keepalive_intvl = 10, keepalive_probes = 6;
+	bool unixClient = (listenSocket == m_unixListenSocket);
 
-	*clientSocket = ::accept(m_listenSocket, reinterpret_cast<struct sockaddr*>(m_address), &addrlen);
+	if (unixClient) {
+		*clientSocket = ::accept(listenSocket, nullptr, nullptr);
+	} else {
+		*clientSocket = ::accept(listenSocket, reinterpret_cast<struct sockaddr*>(m_address), &addrlen);
+	}
 	if (*clientSocket < 0) {
 		return -EAGAIN;
 	}
 	Logger::log(IIO_EMU_DEBUG, {"Accept socket: ", std::to_string(*clientSocket)});
 
+	// SocketUnix waits for the socket readiness instead of blocking in recv/send
+	if (fcntl(*clientSocket, F_SETFL, O_NONBLOCK) < 0) {
+		return -1;
+	}
+
+	// the TCP options don't apply to the local clients
+	if (unixClient) {
+		return 0;
+	}
+
 	ret = setsockopt(static_cast<int>(*clientSocket), SOL_SOCKET, SO_KEEPALIVE, &yes, sizeof(yes));
 	if (ret < 0) {
 		return -1;
@@ -173,30 +289,52 @@ int NetworkUnix::checkForNewConnections()
 	int ret, maxFd, total, new_socket;
 
 	FD_ZERO(&m_fd_set);
+	FD_ZERO(&m_write_fd_set);
 
 	FD_SET(m_listenSocket, &m_fd_set);
 	maxFd = m_listenSocket;
+	for (auto fd : {m_unixListenSocket, m_wakeFd}) {
+		if (fd >= 0) {
+			FD_SET(fd, &m_fd_set);
+			maxFd = std::max(maxFd, fd);
+		}
+	}
 
 	for (auto& client : clients) {
-		FD_SET(client, &m_fd_set);
+		if (isWriteWatched(client)) {
+			FD_SET(client, &m_write_fd_set);
+		} else {
+			FD_SET(client, &m_fd_set);
+		}
 	}
 
 	if (!clients.empty()) {
 		auto it = std::max_element(std::begin(clients), std::end(clients));
-		maxFd = *it;
+		maxFd = std::max(maxFd, *it);
 	}
 
-	total = select(maxFd + 1, &m_fd_set, nullptr, nullptr, nullptr);
+	total = select(maxFd + 1, &m_fd_set, &m_write_fd_set, nullptr, nullptr);
 
 	if ((total < 0) && (errno != EINTR)) {
 		close();
 		return -1;
 	}
 
-	if (FD_ISSET(m_listenSocket, &m_fd_set)) {
-		ret = this->accept(&new_socket);
-		if (ret == EAGAIN) {
-			return 0;
+	if (total <= 0) {
+		return 0;
+	}
+
+	if (m_wakeFd >= 0 && FD_ISSET(m_wakeFd, &m_fd_set)) {
+		clearWakeUp();
+	}
+
+	for (auto listenSocket : {m_listenSocket, m_unixListenSocket}) {
+		if (listenSocket < 0 || !FD_ISSET(listenSocket, &m_fd_set)) {
+			continue;
+		}
+		ret = this->accept(listenSocket, &new_socket);
+		if (ret == -EAGAIN) {
+			continue;
 		}
 		if (ret < 0) {
 			close();
@@ -208,21 +346,54 @@ int NetworkUnix::checkForNewConnections()
 	return 0;
 }
 
-std::vector<int> NetworkUnix::getActiveConnections()
+void NetworkUnix::wakeUp()
+{
+	char value = 0;
+	if (m_wakeWriteFd >= 0 && write(m_wakeWriteFd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+		Logger::log(IIO_EMU_ERROR, {"Failed wake up"});
+	}
+}
+
+void NetworkUnix::clearWakeUp()
+{
+	char buf[64];
+	while (::read(m_wakeFd, buf, sizeof(buf)) > 0) {
+	}
+}
+
+const std::vector<int>& NetworkUnix::getActiveConnections()
 {
-	std::vector<int> activeConnections;
+	m_activeConnections.clear();
 	for (auto client : clients) {
-		if (FD_ISSET(client, &m_fd_set)) {
-			activeConnections.push_back(client);
+		if (FD_ISSET(client, &m_fd_set) || FD_ISSET(client, &m_write_fd_set)) {
+			m_activeConnections.push_back(client);
 		}
 	}
-	return activeConnections;
+	return m_activeConnections;
 }
 
 void NetworkUnix::disconnectSocket(int socket)
 {
 	Logger::log(IIO_EMU_DEBUG, {"Disconnect socket: ", std::to_string(socket)});
 	clients.erase(std::remove(clients.begin(), clients.end(), socket), clients.end());
+	m_writeClients.erase(std::remove(m_writeClients.begin(), m_writeClients.end(), socket), m_writeClients.end());
+}
+
+void NetworkUnix::watchSocket(int socket, bool writable)
+{
+	if (writable && !isWriteWatched(socket)) {
+		m_writeClients.push_back(socket);
+	} else if (!writable) {
+		m_writeClients.erase(std::remove(m_writeClients.begin(), m_writeClients.end(), socket),
+				     m_writeClients.end());
+	}
+}
+
+AbstractSocket* NetworkUnix::createSocket(int socket) { return new SocketUnix(socket); }
+
+bool NetworkUnix::isWriteWatched(int socket) const
+{
+	return std::find(m_writeClients.begin(), m_writeClients.end(), socket) != m_writeClients.end();
 }
 
 #endif
@@ -42,6 +42,7 @@
 
 #include "network_interface.hpp"
 
+#include <string>
 #include <sys/socket.h>
 #include <vector>
 
@@ -59,24 +60,50 @@ public:
 
 	int close() override;
 
+	int setReusePort() override;
+
 	int bind(uint16_t port) override;
 
+	int bindUnix(const char* path) override;
+
 	int listen(int backlog) override;
 
 	int checkForNewConnections() override;
 
-	std::vector<int> getActiveConnections() override;
+	void wakeUp() override;
+
+	const std::vector<int>& getActiveConnections() override;
 
 	void disconnectSocket(int socket) override;
 
-private:
-	int accept(int* clientSocket);
+	void watchSocket(int socket, bool writable) override;
+
+	AbstractSocket* createSocket(int socket) override;
+
+protected:
+	int accept(int listenSocket, int* clientSocket);
+	// consumes the pending wakeUp() calls
+	void clearWakeUp();
 
 private:
+	bool isWriteWatched(int socket) const;
+
+protected:
 	struct sockaddr_in* m_address;
-	fd_set m_fd_set;
 	int m_listenSocket;
+	int m_unixListenSocket;
+	// readable end of the wakeUp() pipe
+	int m_wakeFd;
+	std::vector<int> m_activeConnections;
+
+private:
+	std::string m_unixPath;
+	int m_wakeWriteFd;
+	fd_set m_fd_set;
+	fd_set m_write_fd_set;
 	std::vector<int> clients;
+	// clients waiting to receive their queued data
+	std::vector<int> m_writeClients;
 };
 } // namespace iio_emu
 #endif // IIO_EMU_NETWORK_UNIX_HPP
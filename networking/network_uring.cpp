@@ -0,0 +1,505 @@
+/*
+ * ADIBSD License
+ *
+ * Copyright (c) 2021 Analog Devices Inc.
+ * All rights reserved.
+ *
+ * This file is part of iio-emu
+ * (see http://www.github.com/analogdevicesinc/iio-emu).
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *     - Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     - Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     - Neither the name of Analog Devices, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *     - The use of this software may or may not infringe the patent rights
+ *       of one or more patent holders.  This license does not release you
+ *       from the requirement that you obtain separate licenses from these
+ *       patent holders to use this software.
+ *     - Use of the software either in source or binary form, must be run
+ *       on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.
+ *
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, INTELLECTUAL PROPERTY
+ * RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if defined(IIO_EMU_IO_URING)
+
+#include "network_uring.hpp"
+#include "socket_uring.hpp"
+
+#include "utils/logger.hpp"
+#include "utils/utility.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace iio_emu;
+
+constexpr unsigned int RING_ENTRIES = 256;
+
+// operations in flight, stored in the completion user data next to the socket
+enum : uint8_t
+{
+	OP_POLL_LISTEN,
+	OP_POLL,
+	OP_RECV,
+	OP_SEND,
+	OP_SEND_POLL,
+	OP_POLL_WAKE,
+};
+
+static int ioUringSetup(unsigned int entries, struct io_uring_params* params)
+{
+	return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int ioUringEnter(int fd, unsigned int toSubmit, unsigned int minComplete, unsigned int flags)
+{
+	return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+NetworkUring::NetworkUring()
+	: m_ringFd(-1)
+	, m_sqRing(nullptr)
+	, m_sqRingSize(0)
+	, m_cqRing(nullptr)
+	, m_cqRingSize(0)
+	, m_sqes(nullptr)
+	, m_sqesSize(0)
+	, m_sqHead(nullptr)
+	, m_sqTail(nullptr)
+	, m_sqMask(nullptr)
+	, m_sqArray(nullptr)
+	, m_sqEntries(0)
+	, m_toSubmit(0)
+	, m_cqHead(nullptr)
+	, m_cqTail(nullptr)
+	, m_cqMask(nullptr)
+	, m_cqes(nullptr)
+{}
+
+NetworkUring::~NetworkUring() { release(); }
+
+bool NetworkUring::isSupported()
+{
+	struct io_uring_params params = {};
+	int fd = ioUringSetup(1, &params);
+	if (fd < 0) {
+		return false;
+	}
+
+	// the socket receive and send operations are available since Linux 5.6
+	constexpr unsigned int probeOps = 256;
+	std::vector<char> buffer(sizeof(struct io_uring_probe) + probeOps * sizeof(struct io_uring_probe_op));
+	auto probe = reinterpret_cast<struct io_uring_probe*>(buffer.data());
+	bool supported = syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, probeOps) == 0;
+	for (auto opcode : {IORING_OP_POLL_ADD, IORING_OP_RECV, IORING_OP_SEND}) {
+		supported = supported && opcode < probe->ops_len && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+	}
+	::close(fd);
+	return supported;
+}
+
+int NetworkUring::open()
+{
+	if (setup() < 0) {
+		Logger::log(IIO_EMU_ERROR, {"Failed io_uring setup"});
+		return -1;
+	}
+	return NetworkUnix::open();
+}
+
+int NetworkUring::close()
+{
+	release();
+	return NetworkUnix::close();
+}
+
+int NetworkUring::listen(int backlog)
+{
+	int ret = NetworkUnix::listen(backlog);
+	if (ret < 0) {
+		return ret;
+	}
+
+	for (auto listenSocket : {m_listenSocket, m_unixListenSocket}) {
+		if (listenSocket >= 0 && !prepare(IORING_OP_POLL_ADD, listenSocket, nullptr, 0, POLLIN, OP_POLL_LISTEN)) {
+			close();
+			return -1;
+		}
+	}
+
+	if (!prepare(IORING_OP_POLL_ADD, m_wakeFd, nullptr, 0, POLLIN, OP_POLL_WAKE)) {
+		close();
+		return -1;
+	}
+	return 0;
+}
+
+int NetworkUring::checkForNewConnections()
+{
+	// the clients handled since the last call wait for their next command
+	for (auto socket : m_activeConnections) {
+		auto it = m_clients.find(socket);
+		if (it != m_clients.end()) {
+			it->second.active = false;
+			arm(socket);
+		}
+	}
+	m_activeConnections.clear();
+
+	// a single call submits the new operations and waits for the completions
+	int ret = submit((m_readyClients.empty() && m_readyListeners.empty()) ? 1 : 0);
+	if (ret < 0 && ret != -EINTR && ret != -EBUSY) {
+		Logger::log(IIO_EMU_ERROR, {"Failed io_uring submit: ", std::to_string(-ret)});
+		close();
+		return -1;
+	}
+	processCompletions();
+
+	for (auto listenSocket : m_readyListeners) {
+		acceptConnections(listenSocket);
+	}
+	m_readyListeners.clear();
+
+	for (auto socket : m_readyClients) {
+		auto it = m_clients.find(socket);
+		if (it != m_clients.end() && !it->second.active) {
+			it->second.active = true;
+			m_activeConnections.push_back(socket);
+		}
+	}
+	m_readyClients.clear();
+	return 0;
+}
+
+const std::vector<int>& NetworkUring::getActiveConnections() { return m_activeConnections; }
+
+void NetworkUring::disconnectSocket(int socket)
+{
+	Logger::log(IIO_EMU_DEBUG, {"Disconnect socket: ", std::to_string(socket)});
+
+	auto it = m_clients.find(socket);
+	if (it == m_clients.end()) {
+		return;
+	}
+
+	// the ring has to release the socket data before the socket is destroyed
+	if (it->second.socket != nullptr && it->second.socket->isSending()) {
+		shutdown(socket, SHUT_RDWR);
+		waitSend(it->second.socket);
+	}
+	m_clients.erase(socket);
+}
+
+void NetworkUring::watchSocket(int socket, bool writable)
+{
+	// a client is reported once its input is received or its queued data is sent, by the ring operations
+	UNUSED(socket);
+	UNUSED(writable);
+}
+
+AbstractSocket* NetworkUring::createSocket(int socket)
+{
+	auto uringSocket = new SocketUring(socket, this);
+	m_clients[socket].socket = uringSocket;
+	return uringSocket;
+}
+
+void NetworkUring::submitSend(int socket, const char* buf, size_t len)
+{
+	if (!prepare(IORING_OP_SEND, socket, buf, static_cast<uint32_t>(len), MSG_NOSIGNAL, OP_SEND)) {
+		auto it = m_clients.find(socket);
+		if (it != m_clients.end() && it->second.socket != nullptr) {
+			it->second.socket->completeSend(-EIO);
+		}
+	}
+}
+
+void NetworkUring::waitSend(SocketUring* socket)
+{
+	while (socket->isSending()) {
+		int ret = submit(1);
+		if (ret < 0 && ret != -EINTR && ret != -EBUSY) {
+			Logger::log(IIO_EMU_ERROR, {"Failed io_uring submit: ", std::to_string(-ret)});
+			socket->completeSend(ret);
+			return;
+		}
+		processCompletions();
+	}
+}
+
+int NetworkUring::setup()
+{
+	struct io_uring_params params = {};
+
+	m_ringFd = ioUringSetup(RING_ENTRIES, &params);
+	if (m_ringFd < 0) {
+		return -1;
+	}
+
+	m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+	m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+	if (singleMmap) {
+		m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+	}
+
+	m_sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd,
+			IORING_OFF_SQ_RING);
+	if (m_sqRing == MAP_FAILED) {
+		m_sqRing = nullptr;
+		release();
+		return -1;
+	}
+
+	if (singleMmap) {
+		m_cqRing = m_sqRing;
+	} else {
+		m_cqRing = mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd,
+				IORING_OFF_CQ_RING);
+		if (m_cqRing == MAP_FAILED) {
+			m_cqRing = nullptr;
+			release();
+			return -1;
+		}
+	}
+
+	m_sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+	void* sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd,
+			  IORING_OFF_SQES);
+	if (sqes == MAP_FAILED) {
+		release();
+		return -1;
+	}
+	m_sqes = static_cast<struct io_uring_sqe*>(sqes);
+
+	auto sq = static_cast<char*>(m_sqRing);
+	m_sqHead = reinterpret_cast<unsigned int*>(sq + params.sq_off.head);
+	m_sqTail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+	m_sqMask = reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+	m_sqArray = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+	m_sqEntries = params.sq_entries;
+
+	auto cq = static_cast<char*>(m_cqRing);
+	m_cqHead = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+	m_cqTail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+	m_cqMask = reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+	m_cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+	return 0;
+}
+
+void NetworkUring::release()
+{
+	if (m_sqes != nullptr) {
+		munmap(m_sqes, m_sqesSize);
+		m_sqes = nullptr;
+	}
+	if (m_cqRing != nullptr && m_cqRing != m_sqRing) {
+		munmap(m_cqRing, m_cqRingSize);
+	}
+	m_cqRing = nullptr;
+	if (m_sqRing != nullptr) {
+		munmap(m_sqRing, m_sqRingSize);
+		m_sqRing = nullptr;
+	}
+	if (m_ringFd >= 0) {
+		::close(m_ringFd);
+		m_ringFd = -1;
+	}
+}
+
+bool NetworkUring::prepare(uint8_t opcode, int socket, const void* addr, uint32_t len, uint32_t flags, uint8_t op)
+{
+	if (m_sqes == nullptr) {
+		return false;
+	}
+
+	unsigned int tail = *m_sqTail;
+	if (tail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries) {
+		// the submission queue is full, the kernel consumes all of it
+		int ret = submit(0);
+		if (ret < 0) {
+			Logger::log(IIO_EMU_ERROR, {"Failed io_uring submit: ", std::to_string(-ret)});
+			return false;
+		}
+	}
+
+	unsigned int index = tail & *m_sqMask;
+	struct io_uring_sqe* sqe = &m_sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = opcode;
+	sqe->fd = socket;
+	sqe->addr = reinterpret_cast<uintptr_t>(addr);
+	sqe->len = len;
+	if (opcode == IORING_OP_POLL_ADD) {
+		sqe->poll32_events = flags;
+	} else {
+		sqe->msg_flags = flags;
+	}
+	sqe->user_data = (static_cast<uint64_t>(static_cast<uint32_t>(socket)) << 8) | op;
+
+	m_sqArray[index] = index;
+	__atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+	m_toSubmit++;
+	return true;
+}
+
+int NetworkUring::submit(unsigned int minComplete)
+{
+	if (m_toSubmit == 0 && minComplete == 0) {
+		return 0;
+	}
+
+	int ret = ioUringEnter(m_ringFd, m_toSubmit, minComplete, (minComplete > 0) ? IORING_ENTER_GETEVENTS : 0);
+	if (ret < 0) {
+		return -errno;
+	}
+	m_toSubmit -= std::min(m_toSubmit, static_cast<unsigned int>(ret));
+	return ret;
+}
+
+void NetworkUring::processCompletions()
+{
+	unsigned int head = *m_cqHead;
+	while (head != __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE)) {
+		struct io_uring_cqe* cqe = &m_cqes[head & *m_cqMask];
+		uint64_t userData = cqe->user_data;
+		int res = cqe->res;
+
+		head++;
+		__atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+		complete(userData, res);
+	}
+}
+
+void NetworkUring::complete(uint64_t userData, int res)
+{
+	auto socket = static_cast<int>(userData >> 8);
+	auto op = static_cast<uint8_t>(userData & 0xff);
+
+	if (op == OP_POLL_LISTEN) {
+		m_readyListeners.push_back(socket);
+		return;
+	}
+
+	if (op == OP_POLL_WAKE) {
+		clearWakeUp();
+		prepare(IORING_OP_POLL_ADD, m_wakeFd, nullptr, 0, POLLIN, OP_POLL_WAKE);
+		return;
+	}
+
+	auto it = m_clients.find(socket);
+	if (it == m_clients.end()) {
+		return;
+	}
+	Client& client = it->second;
+
+	switch (op) {
+	case OP_POLL:
+		client.waiting = false;
+		m_readyClients.push_back(socket);
+		break;
+	case OP_RECV:
+		client.waiting = false;
+		if (res == -EAGAIN || res == -EINTR) {
+			// the socket is non-blocking, wait for the data instead
+			client.waiting = prepare(IORING_OP_POLL_ADD, socket, nullptr, 0, POLLIN, OP_POLL);
+			break;
+		}
+		client.socket->completeReceive(res);
+		m_readyClients.push_back(socket);
+		break;
+	case OP_SEND:
+		if ((res == -EAGAIN || res == -EINTR) &&
+		    prepare(IORING_OP_POLL_ADD, socket, nullptr, 0, POLLOUT, OP_SEND_POLL)) {
+			break;
+		}
+		client.socket->completeSend(res);
+		arm(socket);
+		break;
+	case OP_SEND_POLL:
+		client.socket->resumeSend();
+		break;
+	default:
+		break;
+	}
+}
+
+void NetworkUring::arm(int socket)
+{
+	auto it = m_clients.find(socket);
+	if (it == m_clients.end()) {
+		return;
+	}
+	Client& client = it->second;
+
+	// no new command is read from a client until its data is sent
+	if (client.active || client.waiting || (client.socket != nullptr && client.socket->isSending())) {
+		return;
+	}
+
+	// the socket is created by the server once the first command is received
+	if (client.socket == nullptr) {
+		client.waiting = prepare(IORING_OP_POLL_ADD, socket, nullptr, 0, POLLIN, OP_POLL);
+		return;
+	}
+
+	size_t len = 0;
+	char* buf = client.socket->prepareReceive(&len);
+	if (client.socket->disconnected() || buf == nullptr) {
+		// the server has to release the client or execute its buffered commands
+		m_readyClients.push_back(socket);
+		return;
+	}
+	client.waiting = prepare(IORING_OP_RECV, socket, buf, static_cast<uint32_t>(len), 0, OP_RECV);
+}
+
+void NetworkUring::acceptConnections(int listenSocket)
+{
+	int ret, new_socket;
+
+	while (true) {
+		ret = this->accept(listenSocket, &new_socket);
+		if (ret == -EAGAIN) {
+			break;
+		}
+		if (ret < 0) {
+			Logger::log(IIO_EMU_ERROR, {"Failed socket setup: ", std::to_string(new_socket)});
+			::close(new_socket);
+			continue;
+		}
+
+		Logger::log(IIO_EMU_DEBUG, {"Uring new socket: ", std::to_string(new_socket)});
+		m_clients[new_socket] = Client{nullptr, false, false};
+		arm(new_socket);
+	}
+
+	if (!prepare(IORING_OP_POLL_ADD, listenSocket, nullptr, 0, POLLIN, OP_POLL_LISTEN)) {
+		Logger::log(IIO_EMU_ERROR, {"Failed io_uring listen socket registration"});
+	}
+}
+
+#endif
@@ -0,0 +1,141 @@
+/*
+ * ADIBSD License
+ *
+ * Copyright (c) 2021 Analog Devices Inc.
+ * All rights reserved.
+ *
+ * This file is part of iio-emu
+ * (see http://www.github.com/analogdevicesinc/iio-emu).
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *     - Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     - Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     - Neither the name of Analog Devices, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *     - The use of this software may or may not infringe the patent rights
+ *       of one or more patent holders.  This license does not release you
+ *       from the requirement that you obtain separate licenses from these
+ *       patent holders to use this software.
+ *     - Use of the software either in source or binary form, must be run
+ *       on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.
+ *
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, INTELLECTUAL PROPERTY
+ * RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IIO_EMU_NETWORK_URING_HPP
+#define IIO_EMU_NETWORK_URING_HPP
+
+#include "network_unix.hpp"
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+struct io_uring_cqe;
+struct io_uring_sqe;
+
+namespace iio_emu {
+
+class SocketUring;
+
+/*
+ * Linux io_uring event loop backend. The input of the idle clients is
+ * received by the kernel directly into their socket buffers and the
+ * responses are sent by the ring, so the receives, sends and waits of all
+ * the clients are batched in a single system call per loop iteration.
+ * The clients are handled by the event loop thread only.
+ */
+class NetworkUring : public NetworkUnix
+{
+public:
+	NetworkUring();
+	~NetworkUring() override;
+
+	// checks if io_uring can be used, it may be missing or disabled in the running kernel
+	static bool isSupported();
+
+	int open() override;
+
+	int close() override;
+
+	int listen(int backlog) override;
+
+	int checkForNewConnections() override;
+
+	const std::vector<int>& getActiveConnections() override;
+
+	void disconnectSocket(int socket) override;
+
+	void watchSocket(int socket, bool writable) override;
+
+	AbstractSocket* createSocket(int socket) override;
+
+	// used by SocketUring
+	void submitSend(int socket, const char* buf, size_t len);
+	void waitSend(SocketUring* socket);
+
+private:
+	struct Client
+	{
+		SocketUring* socket;
+		// a poll or receive is in flight
+		bool waiting;
+		// reported as active, the server is handling it
+		bool active;
+	};
+
+	int setup();
+	void release();
+
+	bool prepare(uint8_t opcode, int socket, const void* addr, uint32_t len, uint32_t flags, uint8_t op);
+	int submit(unsigned int minComplete);
+	void processCompletions();
+	void complete(uint64_t userData, int res);
+
+	void arm(int socket);
+	void acceptConnections(int listenSocket);
+
+private:
+	int m_ringFd;
+
+	void* m_sqRing;
+	size_t m_sqRingSize;
+	void* m_cqRing;
+	size_t m_cqRingSize;
+	struct io_uring_sqe* m_sqes;
+	size_t m_sqesSize;
+
+	unsigned int* m_sqHead;
+	unsigned int* m_sqTail;
+	unsigned int* m_sqMask;
+	unsigned int* m_sqArray;
+	unsigned int m_sqEntries;
+	unsigned int m_toSubmit;
+
+	unsigned int* m_cqHead;
+	unsigned int* m_cqTail;
+	unsigned int* m_cqMask;
+	struct io_uring_cqe* m_cqes;
+
+	std::map<int, Client> m_clients;
+	// clients reported by the next getActiveConnections()
+	std::vector<int> m_readyClients;
+	std::vector<int> m_readyListeners;
+};
+} // namespace iio_emu
+#endif // IIO_EMU_NETWORK_URING_HPP
@@ -40,8 +40,10 @@
 #if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
 
 #include "network_win.hpp"
+#include "socket_win.hpp"
 
 #include "utils/logger.hpp"
+#include "utils/utility.hpp"
 
 #include <algorithm>
 #include <cerrno>
@@ -200,15 +202,15 @@ int NetworkWin::checkForNewConnections()
 	return 0;
 }
 
-std::vector<int> NetworkWin::getActiveConnections()
+const std::vector<int>& NetworkWin::getActiveConnections()
 {
-	std::vector<int> activeConnections;
+	m_activeConnections.clear();
 	for (auto client : clients) {
 		if (FD_ISSET(client, &m_fd_set)) {
-			activeConnections.push_back(static_cast<int>(client));
+			m_activeConnections.push_back(static_cast<int>(client));
 		}
 	}
-	return activeConnections;
+	return m_activeConnections;
 }
 
 void NetworkWin::disconnectSocket(int socket)
@@ -217,4 +219,30 @@ void NetworkWin::disconnectSocket(int socket)
 	clients.erase(std::remove(clients.begin(), clients.end(), socket), clients.end());
 }
 
+int NetworkWin::bindUnix(const char* path)
+{
+	Logger::log(IIO_EMU_ERROR, {"Unix sockets are not supported on this platform: ", path});
+	return -1;
+}
+
+int NetworkWin::setReusePort()
+{
+	Logger::log(IIO_EMU_ERROR, {"Several listeners are not supported on this platform"});
+	return -1;
+}
+
+void NetworkWin::wakeUp()
+{
+	// a single listener is used on this platform, it is stopped by the signal handler
+}
+
+void NetworkWin::watchSocket(int socket, bool writable)
+{
+	// SocketWin sends the data synchronously, nothing is left queued
+	UNUSED(socket);
+	UNUSED(writable);
+}
+
+AbstractSocket* NetworkWin::createSocket(int socket) { return new SocketWin(socket); }
+
 #endif
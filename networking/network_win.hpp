@@ -56,16 +56,26 @@ public:
 
 	int close() override;
 
+	int setReusePort() override;
+
 	int bind(uint16_t port) override;
 
+	int bindUnix(const char* path) override;
+
 	int listen(int backlog) override;
 
 	int checkForNewConnections() override;
 
-	std::vector<int> getActiveConnections() override;
+	void wakeUp() override;
+
+	const std::vector<int>& getActiveConnections() override;
 
 	void disconnectSocket(int socket) override;
 
+	void watchSocket(int socket, bool writable) override;
+
+	AbstractSocket* createSocket(int socket) override;
+
 private:
 	int accept(SOCKET* clientSocket);
 
@@ -74,6 +84,7 @@ private:
 	FD_SET m_fd_set;
 	SOCKET m_listenSocket;
 	std::vector<SOCKET> clients;
+	std::vector<int> m_activeConnections;
 };
 } // namespace iio_emu
 #endif // IIO_EMU_NETWORK_WIN_HPP
@@ -43,59 +43,333 @@
 
 #include "utils/logger.hpp"
 
+#include <algorithm>
 #include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 using namespace iio_emu;
 
+constexpr size_t RX_BUFFER_SIZE = 16384;
+constexpr size_t TX_BUFFER_SIZE = 16384;
+// above this size write() waits for the client to receive the queued data
+constexpr size_t TX_HIGH_WATERMARK = 262144;
+// time a command may wait for its client, the default timeout of libiio
+constexpr std::chrono::milliseconds CLIENT_TIMEOUT(5000);
+
+#if defined(MSG_MORE)
+constexpr int SEND_MORE = MSG_MORE;
+#else
+constexpr int SEND_MORE = 0;
+#endif
+
 SocketUnix::SocketUnix(int fd)
+	: m_rxBuffer(RX_BUFFER_SIZE)
+	, m_rxStart(0)
+	, m_rxEnd(0)
+	, m_txStart(0)
+	, m_corked(false)
 {
 	m_fd = fd;
 	m_disconnected = false;
+	m_txBuffer.reserve(TX_BUFFER_SIZE);
+}
+
+SocketUnix::~SocketUnix()
+{
+	close(m_fd);
+	Logger::log(IIO_EMU_DEBUG, {"Close socket: ", std::to_string(m_fd)});
 }
 
 size_t SocketUnix::getData(size_t len, char* buf)
 {
+	size_t received = 0;
+
+	while (received < len && !m_disconnected) {
+		if (m_rxStart < m_rxEnd) {
+			size_t count = std::min(len - received, m_rxEnd - m_rxStart);
+			memcpy(buf + received, m_rxBuffer.data() + m_rxStart, count);
+			m_rxStart += count;
+			received += count;
+			continue;
+		}
+
+		m_rxStart = m_rxEnd = 0;
+		if (len - received >= m_rxBuffer.size()) {
+			// large payload, fill the caller's buffer directly
+			auto ret = receive(buf + received, len - received);
+			if (ret > 0) {
+				received += static_cast<size_t>(ret);
+			}
+		} else {
+			auto ret = receive(m_rxBuffer.data(), m_rxBuffer.size());
+			if (ret > 0) {
+				m_rxEnd = static_cast<size_t>(ret);
+			}
+		}
+	}
+
+	if (m_disconnected) {
+		buf[0] = '\0';
+		return 0;
+	}
+	return len;
+}
+
+bool SocketUnix::receiveCommand()
+{
+	if (hasPendingCommand()) {
+		return true;
+	}
+
+	size_t len = 0;
+	char* buf = prepareRxBuffer(&len);
+	while (buf != nullptr) {
+		ssize_t ret = recv(m_fd, buf, len, 0);
+		if (ret < 0 && errno == EINTR) {
+			continue;
+		}
+		if (ret > 0) {
+			m_rxEnd += static_cast<size_t>(ret);
+		} else if (ret == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+			if (ret < 0) {
+				Logger::log(IIO_EMU_ERROR, {"Socket read: ", std::to_string(errno)});
+			}
+			m_disconnected = true;
+		}
+		break;
+	}
+	return hasPendingCommand();
+}
+
+bool SocketUnix::hasPendingCommand() const
+{
+	// the command parser skips the empty lines, they don't make a command
+	const char* line = m_rxBuffer.data() + m_rxStart;
+	const char* end = m_rxBuffer.data() + m_rxEnd;
+	while (line < end) {
+		auto eol = static_cast<const char*>(memchr(line, '\n', static_cast<size_t>(end - line)));
+		if (eol == nullptr) {
+			return false;
+		}
+		if (eol - line > 1 || (eol - line == 1 && *line != '\r')) {
+			return true;
+		}
+		line = eol + 1;
+	}
+	return false;
+}
+
+char* SocketUnix::prepareRxBuffer(size_t* len)
+{
+	// the start of a command line is kept, the rest of it is received after it
+	if (m_rxStart > 0) {
+		memmove(m_rxBuffer.data(), m_rxBuffer.data() + m_rxStart, m_rxEnd - m_rxStart);
+		m_rxEnd -= m_rxStart;
+		m_rxStart = 0;
+	}
+
+	if (m_rxEnd == m_rxBuffer.size()) {
+		Logger::log(IIO_EMU_ERROR, {"Command line too long: ", std::to_string(m_fd)});
+		m_disconnected = true;
+		return nullptr;
+	}
+
+	*len = m_rxBuffer.size() - m_rxEnd;
+	return m_rxBuffer.data() + m_rxEnd;
+}
+
+ssize_t SocketUnix::receive(char* buf, size_t len)
+{
+	// the client may wait for the queued response before sending more data
+	sendQueued();
+
 	ssize_t ret;
-	while (true) {
+	while (!m_disconnected) {
 		ret = recv(m_fd, buf, len, 0);
-		if (ret < 0 && errno == EAGAIN) {
+		if (ret < 0 && errno == EINTR) {
+			continue;
+		}
+		if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
 			Logger::log(IIO_EMU_DEBUG, {"Read socket again: ", std::to_string(m_fd)});
+			// keep sending the queued data while waiting
+			waitFor(hasQueuedData() ? (POLLIN | POLLOUT) : POLLIN);
+			sendQueued();
 			continue;
 		}
 		if (ret <= 0) {
 			if (ret < 0) {
 				Logger::log(IIO_EMU_ERROR, {"Socket read: ", std::to_string(errno)});
 			}
-			buf[0] = '\0';
-			len = 0;
-			close(m_fd);
-			Logger::log(IIO_EMU_DEBUG, {"Close socket: ", std::to_string(m_fd)});
 			m_disconnected = true;
 		}
-		break;
+		return ret;
 	}
-
-	return len;
+	return -1;
 }
 
 void SocketUnix::write(const char* buf, size_t len)
 {
-	ssize_t ret;
-	while (true) {
-		ret = send(m_fd, buf, len, 0);
-		if (ret < 0 && errno == EAGAIN) {
-			Logger::log(IIO_EMU_DEBUG, {"Write socket again: ", std::to_string(m_fd)});
+	if (m_disconnected) {
+		return;
+	}
+
+	if (fitsTxQueue(len)) {
+		queue(buf, len);
+		return;
+	}
+
+	// large payload, it is sent together with the queued data and copied only if the client is slow
+	send(buf, len, SEND_MORE);
+	while (!m_disconnected && m_txBuffer.size() - m_txStart > TX_HIGH_WATERMARK) {
+		Logger::log(IIO_EMU_DEBUG, {"Write socket again: ", std::to_string(m_fd)});
+		waitFor(POLLOUT);
+		send(nullptr, 0, SEND_MORE);
+	}
+}
+
+void SocketUnix::flush()
+{
+	// the response is complete, the next command has its own time to wait for the client
+	m_deadline = {};
+	sendQueued();
+	// a large write sent directly may end the response with nothing queued after it
+	if (m_corked && !m_disconnected && !hasQueuedData()) {
+		uncork();
+	}
+}
+
+void SocketUnix::uncork()
+{
+	// setting TCP_NODELAY pushes the pending frames, even when it is already set
+	int yes = 1;
+	setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+	m_corked = false;
+}
+
+void SocketUnix::sendQueued()
+{
+	if (!m_disconnected && m_txStart < m_txBuffer.size()) {
+		send(nullptr, 0, 0);
+	}
+}
+
+bool SocketUnix::hasQueuedData() const { return m_txStart < m_txBuffer.size(); }
+
+void SocketUnix::send(const char* buf, size_t len, int flags)
+{
+	struct iovec iov[2];
+	struct msghdr msg = {};
+	size_t queued = m_txBuffer.size() - m_txStart;
+	size_t sent = 0;
+
+	msg.msg_iov = iov;
+	if (queued > 0) {
+		iov[msg.msg_iovlen].iov_base = m_txBuffer.data() + m_txStart;
+		iov[msg.msg_iovlen].iov_len = queued;
+		msg.msg_iovlen++;
+	}
+	if (len > 0) {
+		iov[msg.msg_iovlen].iov_base = const_cast<char*>(buf);
+		iov[msg.msg_iovlen].iov_len = len;
+		msg.msg_iovlen++;
+	}
+
+	while (msg.msg_iovlen > 0) {
+		ssize_t ret = sendmsg(m_fd, &msg, flags);
+		if (ret < 0 && errno == EINTR) {
 			continue;
 		}
+		if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			break;
+		}
 		if (ret < 0) {
 			Logger::log(IIO_EMU_ERROR, {"Socket write: ", std::to_string(errno)});
-			close(m_fd);
-			Logger::log(IIO_EMU_DEBUG, {"Close socket: ", std::to_string(m_fd)});
 			m_disconnected = true;
+			m_txBuffer.clear();
+			m_txStart = 0;
+			return;
 		}
-		break;
+
+		// skip the data already sent
+		auto count = static_cast<size_t>(ret);
+		sent += count;
+		while (msg.msg_iovlen > 0 && count >= msg.msg_iov->iov_len) {
+			count -= msg.msg_iov->iov_len;
+			msg.msg_iov++;
+			msg.msg_iovlen--;
+		}
+		if (msg.msg_iovlen > 0) {
+			msg.msg_iov->iov_base = static_cast<char*>(msg.msg_iov->iov_base) + count;
+			msg.msg_iov->iov_len -= count;
+		}
+	}
+
+	if (sent > 0) {
+		m_corked = (flags & SEND_MORE) != 0;
+	}
+
+	if (sent < queued) {
+		m_txStart += sent;
+		queue(buf, len);
+	} else {
+		m_txBuffer.clear();
+		m_txStart = 0;
+		queue(buf + (sent - queued), len - (sent - queued));
+	}
+}
+
+void SocketUnix::queue(const char* buf, size_t len)
+{
+	if (len == 0) {
+		return;
+	}
+
+	if (m_txStart == m_txBuffer.size()) {
+		m_txBuffer.clear();
+		m_txStart = 0;
+	} else if (m_txStart >= TX_BUFFER_SIZE) {
+		m_txBuffer.erase(m_txBuffer.begin(), m_txBuffer.begin() + static_cast<ssize_t>(m_txStart));
+		m_txStart = 0;
+	}
+	m_txBuffer.insert(m_txBuffer.end(), buf, buf + len);
+}
+
+bool SocketUnix::fitsTxQueue(size_t len) const { return m_txBuffer.size() - m_txStart + len <= TX_BUFFER_SIZE; }
+
+void SocketUnix::waitFor(short events)
+{
+	struct pollfd fds = {};
+	fds.fd = m_fd;
+	fds.events = events;
+
+	auto now = std::chrono::steady_clock::now();
+	if (m_deadline == std::chrono::steady_clock::time_point()) {
+		m_deadline = now + CLIENT_TIMEOUT;
+	}
+
+	while (true) {
+		auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(m_deadline - now).count();
+		int ret = (timeout > 0) ? poll(&fds, 1, static_cast<int>(timeout)) : 0;
+		if (ret > 0) {
+			return;
+		}
+		if (ret == 0) {
+			Logger::log(IIO_EMU_ERROR, {"Socket timeout: ", std::to_string(m_fd)});
+			m_disconnected = true;
+			return;
+		}
+		if (errno != EINTR) {
+			Logger::log(IIO_EMU_ERROR, {"Socket poll: ", std::to_string(errno)});
+			m_disconnected = true;
+			return;
+		}
+		now = std::chrono::steady_clock::now();
 	}
 }
 
@@ -42,6 +42,10 @@
 
 #include "abstract_socket.hpp"
 
+#include <chrono>
+#include <sys/types.h>
+#include <vector>
+
 namespace iio_emu {
 
 class SocketUnix : public AbstractSocket
@@ -49,19 +53,64 @@ class SocketUnix : public AbstractSocket
 public:
 	explicit SocketUnix(int fd);
 
-	~SocketUnix() override = default;
+	// closes the connection
+	~SocketUnix() override;
 
 	size_t getData(size_t len, char* buf) override;
 
+	bool receiveCommand() override;
+
+	bool hasPendingCommand() const override;
+
 	void write(const char* buf, size_t len) override;
 
+	void flush() override;
+
+	bool hasQueuedData() const override;
+
 	bool disconnected() const override;
 
 	int getDescriptor() const override;
 
-private:
+protected:
+	ssize_t receive(char* buf, size_t len);
+	// sends the queue followed by buf, the data that would block is queued
+	void send(const char* buf, size_t len, int flags);
+	void queue(const char* buf, size_t len);
+	// the data is small enough to be gathered with the rest of the response
+	bool fitsTxQueue(size_t len) const;
+	// the client is dropped once the command waited too long for it
+	void waitFor(short events);
+	// free space at the end of the input, nullptr if a command line doesn't fit the buffer
+	char* prepareRxBuffer(size_t* len);
+	// sends what it can of the queued data before waiting for the client
+	virtual void sendQueued();
+	// pushes the data the kernel holds back after a send with MSG_MORE
+	void uncork();
+
+protected:
 	int m_fd;
 	bool m_disconnected;
+
+	/*
+	 * tinyiiod parses commands one byte at a time, the data is received in
+	 * large chunks and the small reads are served from this buffer
+	 */
+	std::vector<char> m_rxBuffer;
+	size_t m_rxStart;
+	size_t m_rxEnd;
+
+	/*
+	 * the response fragments of a command are gathered and sent together,
+	 * the data the client isn't ready to receive yet also stays here
+	 */
+	std::vector<char> m_txBuffer;
+	size_t m_txStart;
+	// the last send used MSG_MORE, its tail may still be waiting in the kernel
+	bool m_corked;
+
+	// the event loop is blocked while a command waits for its client, the wait is limited
+	std::chrono::steady_clock::time_point m_deadline;
 };
 } // namespace iio_emu
 #endif // IIO_EMU_SOCKET_UNIX_HPP
@@ -0,0 +1,153 @@
+/*
+ * ADIBSD License
+ *
+ * Copyright (c) 2021 Analog Devices Inc.
+ * All rights reserved.
+ *
+ * This file is part of iio-emu
+ * (see http://www.github.com/analogdevicesinc/iio-emu).
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *     - Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     - Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     - Neither the name of Analog Devices, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *     - The use of this software may or may not infringe the patent rights
+ *       of one or more patent holders.  This license does not release you
+ *       from the requirement that you obtain separate licenses from these
+ *       patent holders to use this software.
+ *     - Use of the software either in source or binary form, must be run
+ *       on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.
+ *
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, INTELLECTUAL PROPERTY
+ * RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if defined(IIO_EMU_IO_URING)
+
+#include "socket_uring.hpp"
+
+#include "network_uring.hpp"
+#include "utils/logger.hpp"
+
+using namespace iio_emu;
+
+SocketUring::SocketUring(int fd, NetworkUring* network)
+	: SocketUnix(fd)
+	, m_network(network)
+	, m_txSent(0)
+	, m_sending(false)
+{}
+
+void SocketUring::write(const char* buf, size_t len)
+{
+	// the data sent directly by SocketUnix must follow the one owned by the ring
+	if (m_sending && !fitsTxQueue(len)) {
+		m_network->waitSend(this);
+	}
+	SocketUnix::write(buf, len);
+}
+
+void SocketUring::flush()
+{
+	m_deadline = {};
+	if (!m_disconnected && !m_sending && m_txStart < m_txBuffer.size()) {
+		startSend();
+	} else if (m_corked && !m_disconnected && !m_sending && m_txStart == m_txBuffer.size()) {
+		uncork();
+	}
+}
+
+bool SocketUring::hasQueuedData() const { return m_sending || SocketUnix::hasQueuedData(); }
+
+// the input is received by the ring
+bool SocketUring::receiveCommand() { return hasPendingCommand(); }
+
+char* SocketUring::prepareReceive(size_t* len)
+{
+	if (hasPendingCommand()) {
+		return nullptr;
+	}
+	return prepareRxBuffer(len);
+}
+
+void SocketUring::completeReceive(int res)
+{
+	if (res > 0) {
+		m_rxEnd += static_cast<size_t>(res);
+		return;
+	}
+
+	if (res < 0) {
+		Logger::log(IIO_EMU_ERROR, {"Socket read: ", std::to_string(-res)});
+	}
+	m_disconnected = true;
+}
+
+bool SocketUring::isSending() const { return m_sending; }
+
+void SocketUring::resumeSend()
+{
+	m_network->submitSend(m_fd, m_txSending.data() + m_txSent, m_txSending.size() - m_txSent);
+}
+
+void SocketUring::completeSend(int res)
+{
+	if (res < 0) {
+		Logger::log(IIO_EMU_ERROR, {"Socket write: ", std::to_string(-res)});
+		m_disconnected = true;
+		m_sending = false;
+		m_txSending.clear();
+		m_txBuffer.clear();
+		m_txStart = 0;
+		return;
+	}
+
+	m_txSent += static_cast<size_t>(res);
+	if (m_txSent < m_txSending.size()) {
+		resumeSend();
+		return;
+	}
+
+	m_sending = false;
+	m_txSending.clear();
+	flush();
+}
+
+void SocketUring::sendQueued()
+{
+	// the client is waited for, the data owned by the ring has to be sent first
+	if (m_sending) {
+		m_network->waitSend(this);
+	}
+	SocketUnix::sendQueued();
+}
+
+void SocketUring::startSend()
+{
+	// the buffers are swapped, so the next responses are gathered without allocations
+	m_txSending.swap(m_txBuffer);
+	m_txSent = m_txStart;
+	m_txBuffer.clear();
+	m_txStart = 0;
+	m_sending = true;
+	// sent without MSG_MORE, it also pushes what a direct write left in the kernel
+	m_corked = false;
+	resumeSend();
+}
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * ADIBSD License
+ *
+ * Copyright (c) 2021 Analog Devices Inc.
+ * All rights reserved.
+ *
+ * This file is part of iio-emu
+ * (see http://www.github.com/analogdevicesinc/iio-emu).
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *     - Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     - Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     - Neither the name of Analog Devices, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *     - The use of this software may or may not infringe the patent rights
+ *       of one or more patent holders.  This license does not release you
+ *       from the requirement that you obtain separate licenses from these
+ *       patent holders to use this software.
+ *     - Use of the software either in source or binary form, must be run
+ *       on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.
+ *
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, INTELLECTUAL PROPERTY
+ * RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IIO_EMU_SOCKET_URING_HPP
+#define IIO_EMU_SOCKET_URING_HPP
+
+#include "socket_unix.hpp"
+
+namespace iio_emu {
+
+class NetworkUring;
+
+/*
+ * Client socket of the io_uring backend. The input is received by the ring
+ * until a whole command line is buffered and the response flushed at the end
+ * of a command is sent by the ring before the next command is read.
+ * The data needed in the middle of a command is handled by SocketUnix.
+ */
+class SocketUring : public SocketUnix
+{
+public:
+	SocketUring(int fd, NetworkUring* network);
+
+	void write(const char* buf, size_t len) override;
+
+	void flush() override;
+
+	bool hasQueuedData() const override;
+
+	bool receiveCommand() override;
+
+	// buffer for the next ring receive, nullptr if a command is buffered or its line is too long
+	char* prepareReceive(size_t* len);
+	void completeReceive(int res);
+
+	bool isSending() const;
+	void resumeSend();
+	void completeSend(int res);
+
+protected:
+	void sendQueued() override;
+
+private:
+	void startSend();
+
+private:
+	NetworkUring* m_network;
+
+	// data owned by the ring until the send completes
+	std::vector<char> m_txSending;
+	size_t m_txSent;
+	bool m_sending;
+};
+} // namespace iio_emu
+#endif // IIO_EMU_SOCKET_URING_HPP
@@ -55,6 +55,12 @@ SocketWin::SocketWin(int fd)
 	m_disconnected = false;
 }
 
+SocketWin::~SocketWin()
+{
+	closesocket(m_fd);
+	Logger::log(IIO_EMU_DEBUG, {"Close socket: ", std::to_string(m_fd)});
+}
+
 size_t SocketWin::getData(size_t len, char* buf)
 {
 	ssize_t ret;
@@ -71,8 +77,6 @@ size_t SocketWin::getData(size_t len, char* buf)
 			}
 			buf[0] = '\0';
 			len = 0;
-			closesocket(m_fd);
-			Logger::log(IIO_EMU_DEBUG, {"Close socket: ", std::to_string(m_fd)});
 			m_disconnected = true;
 		}
 		break;
@@ -93,14 +97,21 @@ void SocketWin::write(const char* buf, size_t len)
 			} else {
 				Logger::log(IIO_EMU_ERROR, {"Socket write: ", std::to_string(error)});
 			}
-			closesocket(m_fd);
-			Logger::log(IIO_EMU_DEBUG, {"Close socket: ", std::to_string(m_fd)});
 			m_disconnected = true;
 		}
 		break;
 	}
 }
 
+void SocketWin::flush() {}
+
+bool SocketWin::hasQueuedData() const { return false; }
+
+// the socket is blocking, the command is received while it is read
+bool SocketWin::receiveCommand() { return true; }
+
+bool SocketWin::hasPendingCommand() const { return false; }
+
 bool SocketWin::disconnected() const { return m_disconnected; }
 
 int SocketWin::getDescriptor() const { return static_cast<int>(m_fd); }
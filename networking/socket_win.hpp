@@ -57,12 +57,21 @@ class SocketWin : public AbstractSocket
 public:
 	explicit SocketWin(int fd);
 
-	~SocketWin() override = default;
+	// closes the connection
+	~SocketWin() override;
 
 	size_t getData(size_t len, char* buf) override;
 
+	bool receiveCommand() override;
+
+	bool hasPendingCommand() const override;
+
 	void write(const char* buf, size_t len) override;
 
+	void flush() override;
+
+	bool hasQueuedData() const override;
+
 	bool disconnected() const override;
 
 	int getDescriptor() const override;
@@ -40,34 +40,40 @@
 #include "tcp_server.hpp"
 
 #include "iiod/ops/factory_ops.hpp"
+#include "iiod/ops/session.hpp"
 
 #include <iiod/ops/abstract_ops.hpp>
+#include "abstract_socket.hpp"
 #if !defined(_WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
+#if defined(__linux__)
+#include "network_epoll.hpp"
+#endif
+#if defined(IIO_EMU_IO_URING)
+#include "network_uring.hpp"
+#endif
 #include "network_unix.hpp"
-#include "socket_unix.hpp"
 #else
 #include "network_win.hpp"
-#include "socket_win.hpp"
 #endif
 #include "utils/logger.hpp"
 #include "utils/utility.hpp"
 
+#include <atomic>
 #include <csignal>
 #include <iostream>
 #include <vector>
-extern "C"
-{
-#include <tinyiiod/tinyiiod.h>
-}
-
 
 constexpr int BACKLOG = 64;
 
-bool running = true;
+std::atomic<bool> running(true);
 
 using namespace iio_emu;
 
 TcpServer::TcpServer(const char* type, std::vector<const char*>& args)
+	: m_ioUring(false)
+	, m_workersCount(0)
+	, m_stopWorkers(false)
+	, m_listenersCount(1)
 {
 	FactoryOps factory;
 	m_ops = factory.buildOps(type, args);
@@ -75,21 +81,29 @@ TcpServer::TcpServer(const char* type, std::vector<const char*>& args)
 		Logger::log(IIO_EMU_FATAL, {"No such device"});
 		exit(1);
 	}
-	m_iiod = tinyiiod_create(m_ops->getIIODOps());
 }
 
 TcpServer::~TcpServer()
 {
-	if (m_iiod) {
-		tinyiiod_destroy(m_iiod);
+	stopWorkers();
+
+	for (auto& session : m_sessions) {
+		delete session.second;
 	}
 
 	delete m_ops;
 }
 
+void TcpServer::setWorkersCount(unsigned int count) { m_workersCount = count; }
+
+void TcpServer::setIoUring(bool enable) { m_ioUring = enable; }
+
+void TcpServer::setUnixSocketPath(const char* path) { m_unixPath = path; }
+
+void TcpServer::setListenersCount(unsigned int count) { m_listenersCount = count; }
+
 bool TcpServer::start(uint16_t port)
 {
-	int ret;
 	bool errorOccured = false;
 
 	signal(SIGINT, TcpServer::stop);
@@ -102,14 +116,98 @@ bool TcpServer::start(uint16_t port)
 	signal(SIGPIPE, SIG_IGN);
 #endif
 
-	NetworkInterface* networkInterface;
-#if !defined(_WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
+#if defined(__linux__)
+	if (m_listenersCount > 1 && m_workersCount > 0) {
+		Logger::log(IIO_EMU_WARNING, {"Each listener handles its own clients, worker threads are not used"});
+		m_workersCount = 0;
+	}
+#else
+	if (m_listenersCount > 1) {
+		Logger::log(IIO_EMU_WARNING, {"Several listeners are not supported on this platform"});
+		m_listenersCount = 1;
+	}
+#endif
+
+	// the unix domain socket is served by the first listener only
+	NetworkInterface* networkInterface = createListener(port, true);
+	if (networkInterface == nullptr) {
+		return false;
+	}
+
+	for (unsigned int i = 1; i < m_listenersCount; i++) {
+		auto listener = createListener(port, false);
+		if (listener == nullptr) {
+			stopListeners();
+			networkInterface->close();
+			delete networkInterface;
+			return false;
+		}
+		m_listeners.emplace_back();
+		m_listeners.back().network = listener;
+	}
+
+#if defined(__linux__)
+	startWorkers(dynamic_cast<NetworkEpoll*>(networkInterface));
+	startListeners();
+#else
+	if (m_workersCount > 0) {
+		Logger::log(IIO_EMU_WARNING, {"Worker threads are not supported on this platform"});
+		m_workersCount = 0;
+	}
+	if (m_ioUring) {
+		Logger::log(IIO_EMU_WARNING, {"io_uring is not supported on this platform"});
+	}
+#endif
+	Logger::log(IIO_EMU_INFO, {"Waiting for connections ..."});
+
+	errorOccured = !run(networkInterface);
+	stopListeners();
+	stopWorkers();
+
+	if (!errorOccured) {
+		networkInterface->close();
+	}
+	delete networkInterface;
+	Logger::log(IIO_EMU_INFO, {"Server stopped"});
+	return !errorOccured;
+}
+
+NetworkInterface* TcpServer::createNetworkInterface()
+{
+	NetworkInterface* networkInterface = nullptr;
+#if defined(__linux__)
+	if (m_ioUring) {
+#if defined(IIO_EMU_IO_URING)
+		if (m_workersCount > 0) {
+			Logger::log(IIO_EMU_WARNING, {"The io_uring backend doesn't use worker threads, using epoll"});
+		} else if (!NetworkUring::isSupported()) {
+			Logger::log(IIO_EMU_WARNING, {"io_uring is not available, using epoll"});
+		} else {
+			networkInterface = new NetworkUring();
+			Logger::log(IIO_EMU_INFO, {"Using io_uring"});
+		}
+#else
+		Logger::log(IIO_EMU_WARNING, {"Built without io_uring support, using epoll"});
+#endif
+	}
+	if (networkInterface == nullptr) {
+		networkInterface = new NetworkEpoll(m_workersCount > 0);
+	}
+#elif !defined(_WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
 	networkInterface = new NetworkUnix();
 #else
 	networkInterface = new NetworkWin();
 #endif
+	return networkInterface;
+}
+
+NetworkInterface* TcpServer::createListener(uint16_t port, bool withUnixSocket)
+{
+	int ret;
+
+	NetworkInterface* networkInterface = createNetworkInterface();
 	if (networkInterface == nullptr) {
-		return false;
+		return nullptr;
 	}
 
 	// create listen socket
@@ -117,59 +215,240 @@ bool TcpServer::start(uint16_t port)
 	if (ret < 0) {
 		Logger::log(IIO_EMU_FATAL, {"Socket cannot be created: ", strerror(errno)});
 		delete networkInterface;
-		return false;
+		return nullptr;
+	}
+
+	if (m_listenersCount > 1) {
+		ret = networkInterface->setReusePort();
+		if (ret < 0) {
+			Logger::log(IIO_EMU_FATAL, {"Port sharing failed: ", strerror(errno)});
+			networkInterface->close();
+			delete networkInterface;
+			return nullptr;
+		}
 	}
 
 	ret = networkInterface->bind(port);
 	if (ret < 0) {
 		Logger::log(IIO_EMU_FATAL, {"Bind failed: ", strerror(errno)});
 		delete networkInterface;
-		return false;
+		return nullptr;
+	}
+
+	if (withUnixSocket && !m_unixPath.empty()) {
+		ret = networkInterface->bindUnix(m_unixPath.c_str());
+		if (ret < 0) {
+			Logger::log(IIO_EMU_FATAL, {"Unix socket bind failed: ", strerror(errno)});
+			networkInterface->close();
+			delete networkInterface;
+			return nullptr;
+		}
+		Logger::log(IIO_EMU_INFO, {"Unix socket: ", m_unixPath});
 	}
 
 	ret = networkInterface->listen(BACKLOG);
 	if (ret < 0) {
 		Logger::log(IIO_EMU_FATAL, {"Listen failed: ", strerror(errno)});
 		delete networkInterface;
-		return false;
+		return nullptr;
 	}
-	Logger::log(IIO_EMU_INFO, {"Waiting for connections ..."});
+	return networkInterface;
+}
+
+bool TcpServer::run(NetworkInterface* networkInterface)
+{
+	int ret;
 
 	while (running) {
 		ret = networkInterface->checkForNewConnections();
 		if (ret < 0) {
 			Logger::log(IIO_EMU_FATAL, {"New connection failed: ", strerror(errno)});
-			errorOccured = true;
-			break;
+			return false;
 		}
 
 		// handle active connections
-		auto activeConnections = networkInterface->getActiveConnections();
+		const auto& activeConnections = networkInterface->getActiveConnections();
+		if (m_workersCount > 0) {
+			if (!activeConnections.empty()) {
+				std::lock_guard<std::mutex> lock(m_pendingMutex);
+				for (auto client : activeConnections) {
+					m_pendingClients.push_back(getSession(client, networkInterface));
+				}
+			}
+			m_pendingCond.notify_all();
+			continue;
+		}
+
 		for (auto client : activeConnections) {
-#if !defined(_WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
-			SocketUnix socket(client);
+			handleCommand(getSession(client, networkInterface), networkInterface);
+		}
+	}
+	return true;
+}
+
+void TcpServer::stop(int signum)
+{
+	UNUSED(signum);
+	running = false;
+}
+
+Session* TcpServer::getSession(int client, NetworkInterface* networkInterface)
+{
+	std::lock_guard<std::mutex> lock(m_sessionsMutex);
+
+	auto it = m_sessions.find(client);
+	if (it != m_sessions.end()) {
+		return it->second;
+	}
+
+	auto session = new Session(m_ops, networkInterface->createSocket(client));
+	m_sessions[client] = session;
+	return session;
+}
+
+void TcpServer::handleCommand(Session* session, NetworkInterface* networkInterface)
+{
+	AbstractSocket* socket = session->getSocket();
+	int client = socket->getDescriptor();
+
+	Logger::log(IIO_EMU_DEBUG, {"Current socket: ", std::to_string(client)});
+
+	// a client with queued data is reported when it can receive it, no new command is read until it's sent
+	bool wasWaiting = socket->hasQueuedData();
+	if (wasWaiting) {
+		socket->flush();
+	}
+
+	/*
+	 * a command is only read once its whole line is received, a partial line is completed by a later
+	 * event. The commands already buffered by the socket won't make the descriptor readable again,
+	 * they are read until a response can't be sent without waiting for the client.
+	 */
+	if (!socket->hasQueuedData() && socket->receiveCommand()) {
+		do {
+			session->readCommand();
+			socket->flush();
+		} while (!socket->disconnected() && !socket->hasQueuedData() && socket->hasPendingCommand());
+	}
+
+	if (!socket->disconnected()) {
+		bool waiting = socket->hasQueuedData();
+		if (m_workersCount > 0) {
+			/*
+			 * the one shot socket is rearmed each time; the event loop
+			 * takes the same lock before handing the session to a worker
+			 */
+			std::lock_guard<std::mutex> lock(m_sessionsMutex);
+			networkInterface->watchSocket(client, waiting);
+		} else if (waiting != wasWaiting) {
+			networkInterface->watchSocket(client, waiting);
+		}
+		return;
+	}
+
+	m_ops->socketDisconnected(*session);
+	networkInterface->disconnectSocket(client);
+	{
+		std::lock_guard<std::mutex> lock(m_sessionsMutex);
+		m_sessions.erase(client);
+	}
+	// the descriptor is released last, so it can't be reused by a new client before this point
+	delete session;
+}
+
+void TcpServer::startWorkers(NetworkEpoll* networkInterface)
+{
+#if defined(__linux__)
+	if (m_workersCount == 0) {
+		return;
+	}
+
+	// signals are handled by the event loop thread, which is blocked in epoll_wait
+	sigset_t blocked, previous;
+	sigfillset(&blocked);
+	pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+
+	m_stopWorkers = false;
+	for (unsigned int i = 0; i < m_workersCount; i++) {
+		m_workers.emplace_back(&TcpServer::runWorker, this, networkInterface);
+	}
+	pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+	Logger::log(IIO_EMU_INFO, {"Worker threads: ", std::to_string(m_workersCount)});
 #else
-			SocketWin socket(client);
+	UNUSED(networkInterface);
 #endif
-			Logger::log(IIO_EMU_DEBUG, {"Current socket: ", std::to_string(socket.getDescriptor())});
-			m_ops->setCurrentSocket(&socket);
-			tinyiiod_read_command(m_iiod);
-			if (socket.disconnected()) {
-				m_ops->socketDisconnected(client);
-				networkInterface->disconnectSocket(client);
+}
+
+void TcpServer::stopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_pendingMutex);
+		m_stopWorkers = true;
+	}
+	m_pendingCond.notify_all();
+
+	for (auto& worker : m_workers) {
+		worker.join();
+	}
+	m_workers.clear();
+}
+
+void TcpServer::runWorker(NetworkEpoll* networkInterface)
+{
+#if defined(__linux__)
+	while (true) {
+		Session* session;
+		{
+			std::unique_lock<std::mutex> lock(m_pendingMutex);
+			m_pendingCond.wait(lock, [this] { return m_stopWorkers || !m_pendingClients.empty(); });
+			if (m_stopWorkers) {
+				break;
 			}
+			session = m_pendingClients.front();
+			m_pendingClients.pop_front();
 		}
+
+		handleCommand(session, networkInterface);
 	}
-	if (!errorOccured) {
-		networkInterface->close();
+#else
+	UNUSED(networkInterface);
+#endif
+}
+
+void TcpServer::startListeners()
+{
+#if defined(__linux__)
+	if (m_listeners.empty()) {
+		return;
 	}
-	delete networkInterface;
-	Logger::log(IIO_EMU_INFO, {"Server stopped"});
-	return !errorOccured;
+
+	// signals are handled by the first listener, the others are woken up to stop
+	sigset_t blocked, previous;
+	sigfillset(&blocked);
+	pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+
+	for (auto& listener : m_listeners) {
+		listener.thread = std::thread(&TcpServer::runListener, this, &listener);
+	}
+	pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+	Logger::log(IIO_EMU_INFO, {"Listeners: ", std::to_string(m_listeners.size() + 1)});
+#endif
 }
 
-void TcpServer::stop(int signum)
+void TcpServer::stopListeners()
 {
-	UNUSED(signum);
 	running = false;
+	for (auto& listener : m_listeners) {
+		if (listener.thread.joinable()) {
+			listener.network->wakeUp();
+			listener.thread.join();
+		}
+		if (!listener.failed) {
+			listener.network->close();
+		}
+		delete listener.network;
+	}
+	m_listeners.clear();
 }
+
+void TcpServer::runListener(Listener* listener) { listener->failed = !run(listener->network); }
@@ -40,14 +40,21 @@
 #ifndef IIO_EMU_TCP_SERVER_H
 #define IIO_EMU_TCP_SERVER_H
 
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 #include <stdint.h>
 
-struct tinyiiod;
-
 namespace iio_emu {
 
 class AbstractOps;
+class NetworkEpoll;
+class NetworkInterface;
+class Session;
 
 class TcpServer
 {
@@ -55,14 +62,72 @@ public:
 	TcpServer(const char* type, std::vector<const char*>& args);
 	~TcpServer();
 
+	/*
+	 * with a non zero count the commands of the ready clients are executed
+	 * by a pool of threads instead of the event loop thread
+	 */
+	void setWorkersCount(unsigned int count);
+
+	// uses the io_uring backend when the kernel supports it, with a single thread handling the clients
+	void setIoUring(bool enable);
+
+	// the clients on the same host can also connect through this unix domain socket
+	void setUnixSocketPath(const char* path);
+
+	/*
+	 * with a count above one, several sockets listen on the same port and
+	 * each one handles its clients on its own thread
+	 */
+	void setListenersCount(unsigned int count);
+
 	bool start(uint16_t port);
 
 private:
+	struct Listener
+	{
+		NetworkInterface* network = nullptr;
+		std::thread thread;
+		bool failed = false;
+	};
+
 	static void stop(int signum);
 
+	NetworkInterface* createNetworkInterface();
+	NetworkInterface* createListener(uint16_t port, bool withUnixSocket);
+	// runs the event loop until the server is stopped, returns false on error
+	bool run(NetworkInterface* networkInterface);
+
+	Session* getSession(int client, NetworkInterface* networkInterface);
+	// the session is destroyed if the client disconnected
+	void handleCommand(Session* session, NetworkInterface* networkInterface);
+
+	void startWorkers(NetworkEpoll* networkInterface);
+	void stopWorkers();
+	void runWorker(NetworkEpoll* networkInterface);
+
+	void startListeners();
+	void stopListeners();
+	void runListener(Listener* listener);
+
 private:
-	struct tinyiiod* m_iiod;
 	AbstractOps* m_ops;
+
+	std::map<int, Session*> m_sessions;
+	std::mutex m_sessionsMutex;
+
+	bool m_ioUring;
+	std::string m_unixPath;
+
+	unsigned int m_workersCount;
+	std::vector<std::thread> m_workers;
+	std::deque<Session*> m_pendingClients;
+	std::mutex m_pendingMutex;
+	std::condition_variable m_pendingCond;
+	bool m_stopWorkers;
+
+	unsigned int m_listenersCount;
+	// listeners other than the one served by the thread calling start()
+	std::deque<Listener> m_listeners;
 };
 } // namespace iio_emu
 
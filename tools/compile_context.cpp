@@ -0,0 +1,88 @@
+/*
+ * ADIBSD License
+ *
+ * Copyright (c) 2021 Analog Devices Inc.
+ * All rights reserved.
+ *
+ * This file is part of iio-emu
+ * (see http://www.github.com/analogdevicesinc/iio-emu).
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *     - Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     - Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     - Neither the name of Analog Devices, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *     - The use of this software may or may not infringe the patent rights
+ *       of one or more patent holders.  This license does not release you
+ *       from the requirement that you obtain separate licenses from these
+ *       patent holders to use this software.
+ *     - Use of the software either in source or binary form, must be run
+ *       on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.
+ *
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, INTELLECTUAL PROPERTY
+ * RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Compiles an emulator context XML into a context image, loaded by
+ * iio-emu without parsing the document.
+ *
+ *	iio-emu_compile_context <input.xml> <output>
+ *	iio-emu_compile_context --header <array_name> <input.xml> <output.h>
+ */
+
+#include "utils/context_image.hpp"
+#include "utils/logger.hpp"
+#include "utils/xml_utils.hpp"
+
+#include <cstring>
+#include <libxml/parser.h>
+
+int main(int argc, char* argv[])
+{
+	const char* arrayName = nullptr;
+	int arg = 1;
+
+	// the errors are only shown in verbose mode
+	iio_emu::Logger::verboseMode = true;
+
+	if (argc == 5 && !strcmp(argv[1], "--header")) {
+		arrayName = argv[2];
+		arg = 3;
+	} else if (argc != 3) {
+		iio_emu::Logger::log(iio_emu::IIO_EMU_ERROR,
+				     {"Usage: ", argv[0], " [--header <array_name>] <input.xml> <output>"});
+		return 1;
+	}
+
+	const char* input = argv[arg];
+	const char* output = argv[arg + 1];
+
+	// as when iio-emu loads an XML, invalid documents are reported but still used
+	if (iio_emu::validateXml(input) < 0) {
+		iio_emu::Logger::log(iio_emu::IIO_EMU_WARNING, {input, " is not valid against its DTD"});
+	}
+
+	iio_emu::ContextImage image;
+	int ret = image.load(input);
+	if (ret == 0) {
+		ret = arrayName ? image.saveHeader(output, arrayName) : image.save(output);
+	}
+
+	xmlCleanupParser();
+	return ret < 0 ? 1 : 0;
+}
@@ -37,26 +37,25 @@
  * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#ifndef IIO_EMU_ATTR_OPS_XML_HPP
-#define IIO_EMU_ATTR_OPS_XML_HPP
+#ifndef IIO_EMU_ATTR_LISTENER_HPP
+#define IIO_EMU_ATTR_LISTENER_HPP
 
-#include "xml_utils.hpp"
+#include <cstddef>
 
 namespace iio_emu {
 
-ssize_t read_device_attr(struct _xmlDoc* doc, const char* device_id, const char* attr, char* buf, size_t len,
-			 enum iio_attr_type type);
-
-ssize_t write_dev_attr(struct _xmlDoc* doc, const char* device_id, const char* attr, const char* buf, size_t len,
-		       enum iio_attr_type type);
-
-ssize_t read_channel_attr(struct _xmlDoc* doc, const char* device_id, const char* channel, bool ch_out,
-			  const char* attr, char* buf, size_t len);
-
-ssize_t write_channel_attr(struct _xmlDoc* doc, const char* device_id, const char* channel, bool ch_out,
-			   const char* attr, const char* buf, size_t len);
-
-ssize_t read_context_attr(struct _xmlDoc* doc, const char* attr, char* buf, size_t len);
-
+/*
+ * Implemented by the models which cache values derived from attributes,
+ * see AttrStore::subscribe
+ */
+class AttrListener
+{
+public:
+	virtual ~AttrListener() = default;
+
+	// called by the thread which wrote the attribute, once the new value is visible
+	virtual void attrChanged(size_t slot) = 0;
+};
 } // namespace iio_emu
-#endif // IIO_EMU_ATTR_OPS_XML_HPP
+
+#endif // IIO_EMU_ATTR_LISTENER_HPP
@@ -0,0 +1,206 @@
+/*
+ * ADIBSD License
+ *
+ * Copyright (c) 2021 Analog Devices Inc.
+ * All rights reserved.
+ *
+ * This file is part of iio-emu
+ * (see http://www.github.com/analogdevicesinc/iio-emu).
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *     - Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     - Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     - Neither the name of Analog Devices, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *     - The use of this software may or may not infringe the patent rights
+ *       of one or more patent holders.  This license does not release you
+ *       from the requirement that you obtain separate licenses from these
+ *       patent holders to use this software.
+ *     - Use of the software either in source or binary form, must be run
+ *       on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.
+ *
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, INTELLECTUAL PROPERTY
+ * RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "attr_ops.hpp"
+
+#include "attr_store.hpp"
+
+ssize_t iio_emu::read_device_attr(AttrStore* store, const char* device_id, const char* attr, char* buf, size_t len,
+				  enum iio_attr_type type)
+{
+	if (!store) {
+		return -ENOENT;
+	}
+
+	ssize_t slot = store->find(device_id, nullptr, false, static_cast<AttrScope>(type), attr);
+	if (slot < 0) {
+		return slot;
+	}
+	return store->read(static_cast<size_t>(slot), buf, len);
+}
+
+ssize_t iio_emu::write_dev_attr(AttrStore* store, const char* device_id, const char* attr, const char* buf,
+				size_t len, enum iio_attr_type type)
+{
+	if (!store) {
+		return -ENOENT;
+	}
+
+	ssize_t slot = store->find(device_id, nullptr, false, static_cast<AttrScope>(type), attr);
+	if (slot < 0) {
+		return slot;
+	}
+	return store->write(static_cast<size_t>(slot), buf, len);
+}
+
+ssize_t iio_emu::read_channel_attr(AttrStore* store, const char* device_id, const char* channel, bool ch_out,
+				   const char* attr, char* buf, size_t len)
+{
+	if (!store) {
+		return -ENOENT;
+	}
+
+	ssize_t slot = store->find(device_id, channel, ch_out, ATTR_SCOPE_CHANNEL, attr);
+	if (slot < 0) {
+		return slot;
+	}
+	return store->read(static_cast<size_t>(slot), buf, len);
+}
+
+ssize_t iio_emu::write_channel_attr(AttrStore* store, const char* device_id, const char* channel, bool ch_out,
+				    const char* attr, const char* buf, size_t len)
+{
+	if (!store) {
+		return -ENOENT;
+	}
+
+	ssize_t slot = store->find(device_id, channel, ch_out, ATTR_SCOPE_CHANNEL, attr);
+	if (slot < 0) {
+		return slot;
+	}
+	return store->write(static_cast<size_t>(slot), buf, len);
+}
+
+ssize_t iio_emu::read_context_attr(AttrStore* store, const char* attr, char* buf, size_t len)
+{
+	if (!store) {
+		return -ENOENT;
+	}
+
+	ssize_t slot = store->find(nullptr, nullptr, false, ATTR_SCOPE_CONTEXT, attr);
+	if (slot < 0) {
+		return slot;
+	}
+	return store->read(static_cast<size_t>(slot), buf, len);
+}
+
+ssize_t iio_emu::read_device_attrs(AttrStore* store, const char* device_id, std::string* out, enum iio_attr_type type)
+{
+	if (!store) {
+		return -ENOENT;
+	}
+
+	return store->readAll(device_id, nullptr, false, static_cast<AttrScope>(type), out);
+}
+
+ssize_t iio_emu::read_channel_attrs(AttrStore* store, const char* device_id, const char* channel, bool ch_out,
+				    std::string* out)
+{
+	if (!store) {
+		return -ENOENT;
+	}
+
+	return store->readAll(device_id, channel, ch_out, ATTR_SCOPE_CHANNEL, out);
+}
+
+int iio_emu::read_device_attr_number(AttrStore* store, const char* device_id, const char* attr, double* value,
+				     enum iio_attr_type type)
+{
+	if (!store) {
+		return -ENOENT;
+	}
+
+	ssize_t slot = store->find(device_id, nullptr, false, static_cast<AttrScope>(type), attr);
+	if (slot < 0) {
+		return static_cast<int>(slot);
+	}
+	return store->readNumber(static_cast<size_t>(slot), value);
+}
+
+int iio_emu::read_channel_attr_number(AttrStore* store, const char* device_id, const char* channel, bool ch_out,
+				      const char* attr, double* value)
+{
+	if (!store) {
+		return -ENOENT;
+	}
+
+	ssize_t slot = store->find(device_id, channel, ch_out, ATTR_SCOPE_CHANNEL, attr);
+	if (slot < 0) {
+		return static_cast<int>(slot);
+	}
+	return store->readNumber(static_cast<size_t>(slot), value);
+}
+
+int iio_emu::read_context_attr_number(AttrStore* store, const char* attr, double* value)
+{
+	if (!store) {
+		return -ENOENT;
+	}
+
+	ssize_t slot = store->find(nullptr, nullptr, false, ATTR_SCOPE_CONTEXT, attr);
+	if (slot < 0) {
+		return static_cast<int>(slot);
+	}
+	return store->readNumber(static_cast<size_t>(slot), value);
+}
+
+int iio_emu::subscribe_device_attr(AttrStore* store, const char* device_id, const char* attr,
+				   enum iio_attr_type type, AttrListener* listener)
+{
+	if (!store) {
+		return -ENOENT;
+	}
+
+	ssize_t slot = store->find(device_id, nullptr, false, static_cast<AttrScope>(type), attr);
+	if (slot < 0) {
+		return static_cast<int>(slot);
+	}
+	return store->subscribe(static_cast<size_t>(slot), listener);
+}
+
+int iio_emu::subscribe_channel_attr(AttrStore* store, const char* device_id, const char* channel, bool ch_out,
+				    const char* attr, AttrListener* listener)
+{
+	if (!store) {
+		return -ENOENT;
+	}
+
+	ssize_t slot = store->find(device_id, channel, ch_out, ATTR_SCOPE_CHANNEL, attr);
+	if (slot < 0) {
+		return static_cast<int>(slot);
+	}
+	return store->subscribe(static_cast<size_t>(slot), listener);
+}
+
+void iio_emu::unsubscribe_attrs(AttrStore* store, AttrListener* listener)
+{
+	if (store) {
+		store->unsubscribe(listener);
+	}
+}
@@ -0,0 +1,481 @@
+/*
+ * ADIBSD License
+ *
+ * Copyright (c) 2021 Analog Devices Inc.
+ * All rights reserved.
+ *
+ * This file is part of iio-emu
+ * (see http://www.github.com/analogdevicesinc/iio-emu).
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *     - Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     - Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     - Neither the name of Analog Devices, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *     - The use of this software may or may not infringe the patent rights
+ *       of one or more patent holders.  This license does not release you
+ *       from the requirement that you obtain separate licenses from these
+ *       patent holders to use this software.
+ *     - Use of the software either in source or binary form, must be run
+ *       on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.
+ *
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, INTELLECTUAL PROPERTY
+ * RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "attr_store.hpp"
+#include "context_image.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+using namespace iio_emu;
+
+// room left for the values to change without reallocation
+constexpr uint32_t VALUE_ALIGN = 16;
+constexpr uint32_t VALUE_MIN_CAPACITY = 32;
+
+static uint32_t valueCapacity(size_t length)
+{
+	auto capacity = static_cast<uint32_t>((length + VALUE_ALIGN) & ~static_cast<size_t>(VALUE_ALIGN - 1));
+	return capacity < VALUE_MIN_CAPACITY ? VALUE_MIN_CAPACITY : capacity;
+}
+
+// the values race with the writers, they are copied as relaxed atomic words and checked with the slot sequence
+static void loadWords(const std::atomic<uint32_t>* words, char* buf, size_t len)
+{
+	for (size_t i = 0; i < len; i += sizeof(uint32_t)) {
+		uint32_t word = words[i / sizeof(uint32_t)].load(std::memory_order_relaxed);
+		memcpy(buf + i, &word, std::min(sizeof(word), len - i));
+	}
+}
+
+static void storeWords(std::atomic<uint32_t>* words, const char* buf, size_t len)
+{
+	for (size_t i = 0; i < len; i += sizeof(uint32_t)) {
+		uint32_t word = 0;
+		memcpy(&word, buf + i, std::min(sizeof(word), len - i));
+		words[i / sizeof(uint32_t)].store(word, std::memory_order_relaxed);
+	}
+}
+
+static size_t wordCount(size_t bytes) { return (bytes + sizeof(uint32_t) - 1) / sizeof(uint32_t); }
+
+AttrStore::AttrStore()
+	: m_records(nullptr)
+	, m_count(0)
+	, m_names(nullptr)
+	, m_namesSize(0)
+	, m_buckets(nullptr)
+	, m_mask(0)
+	, m_valuesSize(0)
+{
+	// the empty name stands for no device or no channel
+	intern("");
+}
+
+AttrStore::AttrStore(const ContextImage& image)
+	: m_records(nullptr)
+	, m_count(0)
+	, m_names(nullptr)
+	, m_namesSize(0)
+	, m_buckets(nullptr)
+	, m_mask(0)
+	, m_valuesSize(0)
+{
+	size_t size;
+
+	// the image checked the bounds and the alignment of its sections
+	m_names = static_cast<const char*>(image.getSection(IMAGE_SECTION_NAMES, &size));
+	m_namesSize = size;
+	m_records = static_cast<const Record*>(image.getSection(IMAGE_SECTION_RECORDS, &size));
+	m_count = size / sizeof(Record);
+	m_buckets = static_cast<const uint32_t*>(image.getSection(IMAGE_SECTION_BUCKETS, &size));
+	m_mask = size / sizeof(uint32_t) - 1;
+
+	// the values change at runtime, the other tables stay shared with the image
+	auto values = static_cast<const char*>(image.getSection(IMAGE_SECTION_VALUES, &size));
+	m_values.reset(new Word[wordCount(size)]());
+	storeWords(m_values.get(), values, size);
+	m_valuesSize = size;
+
+	initSlots();
+	buildSets();
+}
+
+void AttrStore::add(const char* device, const char* channel, bool output, AttrScope scope, const char* name,
+		    const char* value)
+{
+	Record record = {};
+	record.device = intern(device);
+	record.channel = intern(channel);
+	record.name = intern(name);
+	record.scope = scope;
+	record.output = output;
+	record.hash = hash(device, channel, output, scope, name);
+
+	size_t length = strlen(value);
+	record.valueOffset = m_ownValues.size();
+	record.valueLength = static_cast<uint32_t>(length);
+	record.valueCapacity = valueCapacity(length);
+	double number = 0.0;
+	record.numeric = parse_number(value, length, &number);
+	record.number = number;
+	m_ownRecords.push_back(record);
+
+	m_ownValues.resize(m_ownValues.size() + record.valueCapacity);
+	memcpy(m_ownValues.data() + record.valueOffset, value, length + 1);
+}
+
+void AttrStore::finishLoading()
+{
+	// no names are added after loading
+	m_nameIds.clear();
+
+	m_records = m_ownRecords.data();
+	m_count = m_ownRecords.size();
+	m_names = m_ownNames.data();
+	m_namesSize = m_ownNames.size();
+
+	m_valuesSize = m_ownValues.size();
+	m_values.reset(new Word[wordCount(m_valuesSize)]());
+	storeWords(m_values.get(), m_ownValues.data(), m_valuesSize);
+	std::vector<char>().swap(m_ownValues);
+
+	buildTable();
+	initSlots();
+	buildSets();
+}
+
+void AttrStore::buildTable()
+{
+	// at most half of the buckets are used, which keeps the probe sequences short
+	size_t buckets = 16;
+	while (buckets < m_count * 2) {
+		buckets *= 2;
+	}
+	m_ownBuckets.assign(buckets, 0);
+	m_buckets = m_ownBuckets.data();
+	m_mask = buckets - 1;
+
+	for (size_t i = 0; i < m_count; i++) {
+		const Record& record = m_records[i];
+
+		// the first attribute with a given key wins, as with the document walks
+		if (find(getName(record.device), getName(record.channel), record.output, record.scope,
+			 getName(record.name)) >= 0) {
+			continue;
+		}
+
+		size_t bucket = record.hash & m_mask;
+		while (m_ownBuckets[bucket] != 0) {
+			bucket = (bucket + 1) & m_mask;
+		}
+		m_ownBuckets[bucket] = static_cast<uint32_t>(i + 1);
+	}
+}
+
+void AttrStore::initSlots()
+{
+	// published to the other threads when they are started
+	m_slots.reset(new Slot[m_count]);
+	for (size_t i = 0; i < m_count; i++) {
+		const Record& record = m_records[i];
+		Slot& slot = m_slots[i];
+		slot.sequence.store(0, std::memory_order_relaxed);
+		// the value offsets are word aligned, the images are checked for it
+		slot.value.store(m_values.get() + record.valueOffset / sizeof(uint32_t), std::memory_order_relaxed);
+		slot.length.store(record.valueLength, std::memory_order_relaxed);
+		storeWords(slot.number, reinterpret_cast<const char*>(&record.number), sizeof(record.number));
+		slot.numeric.store(record.numeric, std::memory_order_relaxed);
+		slot.subscribed.store(false, std::memory_order_relaxed);
+		slot.capacity = record.valueCapacity;
+	}
+}
+
+void AttrStore::buildSets()
+{
+	// the map nodes stay in place while it grows
+	std::vector<Run>* runs = nullptr;
+	for (size_t i = 0; i < m_count; i++) {
+		const Record& record = m_records[i];
+
+		if (runs) {
+			const Record& previous = m_records[i - 1];
+			if (previous.device == record.device && previous.channel == record.channel &&
+			    previous.output == record.output && previous.scope == record.scope) {
+				runs->back().count++;
+				continue;
+			}
+		}
+
+		runs = &m_sets[hash(getName(record.device), getName(record.channel), record.output, record.scope, "")];
+		runs->push_back({static_cast<uint32_t>(i), 1});
+	}
+}
+
+ssize_t AttrStore::find(const char* device, const char* channel, bool output, AttrScope scope,
+			const char* name) const
+{
+	if (m_buckets == nullptr) {
+		return -ENOENT;
+	}
+
+	if (scope != ATTR_SCOPE_CHANNEL) {
+		channel = "";
+		output = false;
+	}
+	if (scope == ATTR_SCOPE_CONTEXT) {
+		device = "";
+	}
+
+	uint64_t h = hash(device, channel, output, scope, name);
+	for (size_t bucket = h & m_mask; m_buckets[bucket] != 0; bucket = (bucket + 1) & m_mask) {
+		size_t pos = m_buckets[bucket] - 1;
+		const Record& record = m_records[pos];
+		if (record.hash == h && record.scope == scope && record.output == output &&
+		    !strcmp(getName(record.name), name) && !strcmp(getName(record.device), device) &&
+		    !strcmp(getName(record.channel), channel)) {
+			return static_cast<ssize_t>(pos);
+		}
+	}
+	return -ENOENT;
+}
+
+ssize_t AttrStore::read(size_t slot, char* buf, size_t len) const
+{
+	if (slot >= m_count || len == 0) {
+		return -EINVAL;
+	}
+
+	const Slot& entry = m_slots[slot];
+	size_t length;
+	uint32_t sequence;
+	do {
+		sequence = readBegin(entry);
+		// the length first, the buffer holding it was published before
+		length = std::min(static_cast<size_t>(entry.length.load(std::memory_order_acquire)), len - 1);
+		loadWords(entry.value.load(std::memory_order_acquire), buf, length);
+	} while (readRetry(entry, sequence));
+
+	buf[length] = '\0';
+	return static_cast<ssize_t>(length + 1);
+}
+
+ssize_t AttrStore::write(size_t slot, const char* buf, size_t len)
+{
+	if (slot >= m_count) {
+		return -EINVAL;
+	}
+
+	size_t length = strnlen(buf, len);
+
+	// parsed before taking the slot, readers only see the finished result
+	double number = 0.0;
+	bool numeric = parse_number(buf, length, &number);
+
+	Slot& entry = m_slots[slot];
+	writeBegin(entry);
+	if (length >= entry.capacity) {
+		uint32_t capacity = std::max(valueCapacity(length), 2 * entry.capacity);
+		auto value = new Word[wordCount(capacity)]();
+		{
+			std::lock_guard<std::mutex> lock(m_grownMutex);
+			m_grownValues.emplace_back(value);
+		}
+		entry.value.store(value, std::memory_order_release);
+		entry.capacity = capacity;
+	}
+	storeWords(entry.value.load(std::memory_order_relaxed), buf, length);
+	entry.length.store(static_cast<uint32_t>(length), std::memory_order_release);
+	storeWords(entry.number, reinterpret_cast<const char*>(&number), sizeof(number));
+	entry.numeric.store(numeric, std::memory_order_relaxed);
+	bool subscribed = entry.subscribed.load(std::memory_order_relaxed);
+	writeEnd(entry);
+
+	if (subscribed) {
+		std::lock_guard<std::mutex> listenersLock(m_listenersMutex);
+		for (auto& listener : m_listeners) {
+			if (listener.first == slot) {
+				listener.second->attrChanged(slot);
+			}
+		}
+	}
+	return static_cast<ssize_t>(length + 1);
+}
+
+ssize_t AttrStore::readAll(const char* device, const char* channel, bool output, AttrScope scope,
+			   std::string* out) const
+{
+	if (scope != ATTR_SCOPE_CHANNEL) {
+		channel = "";
+		output = false;
+	}
+
+	auto it = m_sets.find(hash(device, channel, output, scope, ""));
+	if (it == m_sets.end()) {
+		return 0;
+	}
+
+	ssize_t count = 0;
+	for (const Run& run : it->second) {
+		// runs of other sets sharing the hash
+		const Record& record = m_records[run.first];
+		if (record.scope != scope || record.output != output || strcmp(getName(record.device), device) ||
+		    strcmp(getName(record.channel), channel)) {
+			continue;
+		}
+
+		for (size_t i = run.first; i < run.first + run.count; i++) {
+			const Slot& entry = m_slots[i];
+			size_t start = out->size();
+			uint32_t sequence;
+			do {
+				sequence = readBegin(entry);
+				uint32_t length = entry.length.load(std::memory_order_acquire);
+				// the terminating zero is part of the value, as for a single read
+				uint32_t size = length + 1;
+				char header[4] = {static_cast<char>(size >> 24), static_cast<char>(size >> 16),
+						  static_cast<char>(size >> 8), static_cast<char>(size)};
+				out->resize(start);
+				out->append(header, sizeof(header));
+				out->resize(out->size() + ((size + 3) & ~3U));
+				loadWords(entry.value.load(std::memory_order_acquire), &(*out)[start + sizeof(header)],
+					  length);
+			} while (readRetry(entry, sequence));
+			count++;
+		}
+	}
+	return count;
+}
+
+int AttrStore::readNumber(size_t slot, double* value) const
+{
+	if (slot >= m_count) {
+		return -EINVAL;
+	}
+
+	const Slot& entry = m_slots[slot];
+	bool numeric;
+	double number;
+	uint32_t sequence;
+	do {
+		sequence = readBegin(entry);
+		numeric = entry.numeric.load(std::memory_order_relaxed);
+		loadWords(entry.number, reinterpret_cast<char*>(&number), sizeof(number));
+	} while (readRetry(entry, sequence));
+
+	if (!numeric) {
+		return -EINVAL;
+	}
+	*value = number;
+	return 0;
+}
+
+int AttrStore::subscribe(size_t slot, AttrListener* listener)
+{
+	if (slot >= m_count || listener == nullptr) {
+		return -EINVAL;
+	}
+
+	std::lock_guard<std::mutex> listenersLock(m_listenersMutex);
+	m_listeners.emplace_back(slot, listener);
+
+	m_slots[slot].subscribed.store(true, std::memory_order_relaxed);
+	return 0;
+}
+
+void AttrStore::unsubscribe(AttrListener* listener)
+{
+	std::lock_guard<std::mutex> listenersLock(m_listenersMutex);
+	m_listeners.erase(std::remove_if(m_listeners.begin(), m_listeners.end(),
+					 [listener](const std::pair<size_t, AttrListener*>& entry) {
+						 return entry.second == listener;
+					 }),
+			  m_listeners.end());
+}
+
+size_t AttrStore::size() const { return m_count; }
+
+void AttrStore::copyValues(char* out) const { loadWords(m_values.get(), out, m_valuesSize); }
+
+uint32_t AttrStore::readBegin(const Slot& slot)
+{
+	uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+	// a writer only holds the slot for a copy
+	while (sequence & 1) {
+		std::this_thread::yield();
+		sequence = slot.sequence.load(std::memory_order_acquire);
+	}
+	return sequence;
+}
+
+bool AttrStore::readRetry(const Slot& slot, uint32_t sequence)
+{
+	// keeps the copy before the second check
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return slot.sequence.load(std::memory_order_relaxed) != sequence;
+}
+
+void AttrStore::writeBegin(Slot& slot)
+{
+	while (true) {
+		uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+		if (!(sequence & 1) &&
+		    slot.sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire)) {
+			break;
+		}
+		std::this_thread::yield();
+	}
+	// keeps the odd sequence before the changes
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+void AttrStore::writeEnd(Slot& slot) { slot.sequence.fetch_add(1, std::memory_order_release); }
+
+uint32_t AttrStore::intern(const char* str)
+{
+	auto it = m_nameIds.find(str);
+	if (it != m_nameIds.end()) {
+		return it->second;
+	}
+
+	auto id = static_cast<uint32_t>(m_ownNames.size());
+	m_ownNames.insert(m_ownNames.end(), str, str + strlen(str) + 1);
+	m_nameIds.emplace(str, id);
+	return id;
+}
+
+const char* AttrStore::getName(uint32_t id) const { return m_names + id; }
+
+uint64_t AttrStore::hash(const char* device, const char* channel, bool output, AttrScope scope, const char* name)
+{
+	// FNV-1a over the key fields, separated by their terminating zero
+	uint64_t h = 14695981039346656037ULL;
+	for (const char* field : {device, channel, name}) {
+		do {
+			h ^= static_cast<unsigned char>(*field);
+			h *= 1099511628211ULL;
+		} while (*field++);
+	}
+	h ^= static_cast<uint64_t>(scope) << 1 | (output ? 1 : 0);
+	h *= 1099511628211ULL;
+	return h ^ (h >> 32);
+}
@@ -0,0 +1,228 @@
+/*
+ * ADIBSD License
+ *
+ * Copyright (c) 2021 Analog Devices Inc.
+ * All rights reserved.
+ *
+ * This file is part of iio-emu
+ * (see http://www.github.com/analogdevicesinc/iio-emu).
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *     - Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     - Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     - Neither the name of Analog Devices, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *     - The use of this software may or may not infringe the patent rights
+ *       of one or more patent holders.  This license does not release you
+ *       from the requirement that you obtain separate licenses from these
+ *       patent holders to use this software.
+ *     - Use of the software either in source or binary form, must be run
+ *       on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.
+ *
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, INTELLECTUAL PROPERTY
+ * RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IIO_EMU_ATTR_STORE_HPP
+#define IIO_EMU_ATTR_STORE_HPP
+
+#include "attr_listener.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tinyiiod/compat.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace iio_emu {
+
+class ContextImage;
+
+// the first three values match enum iio_attr_type
+enum AttrScope : uint8_t
+{
+	ATTR_SCOPE_DEVICE = 0,
+	ATTR_SCOPE_DEBUG = 1,
+	ATTR_SCOPE_BUFFER = 2,
+	ATTR_SCOPE_CHANNEL = 3,
+	ATTR_SCOPE_CONTEXT = 4
+};
+
+/*
+ * Runtime attribute state of a context. The attributes of the context
+ * document are added at load time into a flat table of slots, in document
+ * order. The device, channel and attribute names are interned, the values
+ * live in one preallocated area and a hash index maps the attribute key
+ * (device, channel, direction, scope, name) to its slot. After loading, the
+ * store is the source of truth for the attribute values.
+ *
+ * The names, the records and the index are position independent, so they
+ * can also be used in place from a context image.
+ *
+ * Reads take no lock: each slot has a sequence number, odd while a writer
+ * changes the value, and the readers copy the value until they see the same
+ * even sequence before and after the copy. The values are copied as relaxed
+ * atomic words and a value which outgrows its place moves to a new buffer,
+ * the old one is kept until the store is destroyed.
+ */
+class AttrStore
+{
+public:
+	// an empty store, filled with add() while the context document is read
+	AttrStore();
+	explicit AttrStore(const ContextImage& image);
+
+	AttrStore(const AttrStore&) = delete;
+	AttrStore& operator=(const AttrStore&) = delete;
+
+	// the device and the channel are empty when they do not apply to the scope
+	void add(const char* device, const char* channel, bool output, AttrScope scope, const char* name,
+		 const char* value);
+	// builds the index, once all the attributes are added
+	void finishLoading();
+
+	/*
+	 * returns the slot of the attribute or -ENOENT; the channel is ignored
+	 * except for the channel scope, the device is ignored for the context scope
+	 */
+	ssize_t find(const char* device, const char* channel, bool output, AttrScope scope, const char* name) const;
+
+	// both return the value length including the terminating zero
+	ssize_t read(size_t slot, char* buf, size_t len) const;
+	ssize_t write(size_t slot, const char* buf, size_t len);
+
+	/*
+	 * appends the values of a whole attribute set (one scope of a device,
+	 * or a channel) in document order, encoded as iiod answers a read of
+	 * all the attributes: for each attribute its length as a big endian
+	 * 32 bit integer, then the value padded to 4 bytes; returns the number
+	 * of attributes
+	 */
+	ssize_t readAll(const char* device, const char* channel, bool output, AttrScope scope, std::string* out) const;
+
+	// the value parsed when it was last written, -EINVAL when it is not a number
+	int readNumber(size_t slot, double* value) const;
+
+	/*
+	 * the listener is notified after each write to the slot, until it
+	 * unsubscribes; it must not subscribe or unsubscribe from attrChanged
+	 */
+	int subscribe(size_t slot, AttrListener* listener);
+	void unsubscribe(AttrListener* listener);
+
+	size_t size() const;
+
+private:
+	friend class ContextImage;
+
+	// the loaded description of an attribute, laid out as in context images
+	struct Record
+	{
+		uint32_t device;
+		uint32_t channel;
+		uint32_t name;
+		AttrScope scope;
+		uint8_t output;
+		uint8_t numeric;
+		uint8_t reserved;
+		uint64_t hash;
+		// initial value, in the values area
+		uint64_t valueOffset;
+		uint32_t valueLength;
+		uint32_t valueCapacity;
+		double number;
+	};
+
+	using Word = std::atomic<uint32_t>;
+
+	struct Slot
+	{
+		// even while the value is stable, odd while a writer changes it
+		std::atomic<uint32_t> sequence;
+		// a larger buffer is published before the longer length it holds
+		std::atomic<Word*> value;
+		std::atomic<uint32_t> length;
+		Word number[sizeof(double) / sizeof(uint32_t)];
+		std::atomic<bool> numeric;
+		std::atomic<bool> subscribed;
+		// in bytes, only used by the writer holding the sequence
+		uint32_t capacity;
+	};
+
+	// consecutive records of the same attribute set
+	struct Run
+	{
+		uint32_t first;
+		uint32_t count;
+	};
+
+	void buildTable();
+	void initSlots();
+	void buildSets();
+	// the values area as loaded, for context images
+	void copyValues(char* out) const;
+
+	static uint32_t readBegin(const Slot& slot);
+	static bool readRetry(const Slot& slot, uint32_t sequence);
+	static void writeBegin(Slot& slot);
+	static void writeEnd(Slot& slot);
+
+	uint32_t intern(const char* str);
+	const char* getName(uint32_t id) const;
+
+	static uint64_t hash(const char* device, const char* channel, bool output, AttrScope scope, const char* name);
+
+private:
+	// either owned or part of a context image
+	const Record* m_records;
+	size_t m_count;
+	const char* m_names;
+	size_t m_namesSize;
+	// open addressing table of slot positions plus one, zero marks an empty bucket
+	const uint32_t* m_buckets;
+	size_t m_mask;
+
+	// tables built when loading a document
+	std::vector<Record> m_ownRecords;
+	std::vector<char> m_ownNames;
+	std::vector<uint32_t> m_ownBuckets;
+	// the values are collected while loading, then moved to a single area
+	std::vector<char> m_ownValues;
+	std::unordered_map<std::string, uint32_t> m_nameIds;
+
+	std::unique_ptr<Word[]> m_values;
+	// in bytes
+	size_t m_valuesSize;
+	std::unique_ptr<Slot[]> m_slots;
+	// the runs of each attribute set, by the hash of the set key with an empty name
+	std::unordered_map<uint64_t, std::vector<Run>> m_sets;
+	// the buffers of the values which outgrew their place, readers may still be copying from the old ones
+	std::vector<std::unique_ptr<Word[]>> m_grownValues;
+	std::mutex m_grownMutex;
+
+	std::vector<std::pair<size_t, AttrListener*>> m_listeners;
+	// held while notifying, so that a listener is never called after unsubscribe returns
+	std::mutex m_listenersMutex;
+};
+} // namespace iio_emu
+
+#endif // IIO_EMU_ATTR_STORE_HPP
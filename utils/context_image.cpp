@@ -0,0 +1,420 @@
+/*
+ * ADIBSD License
+ *
+ * Copyright (c) 2021 Analog Devices Inc.
+ * All rights reserved.
+ *
+ * This file is part of iio-emu
+ * (see http://www.github.com/analogdevicesinc/iio-emu).
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *     - Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     - Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     - Neither the name of Analog Devices, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *     - The use of this software may or may not infringe the patent rights
+ *       of one or more patent holders.  This license does not release you
+ *       from the requirement that you obtain separate licenses from these
+ *       patent holders to use this software.
+ *     - Use of the software either in source or binary form, must be run
+ *       on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.
+ *
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, INTELLECTUAL PROPERTY
+ * RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "context_image.hpp"
+#include "attr_store.hpp"
+#include "logger.hpp"
+#include "xml_utils.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#if !defined(_WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace iio_emu;
+
+constexpr size_t SECTION_ALIGN = 8;
+// the header array is written in lines of this many bytes
+constexpr size_t HEADER_LINE_BYTES = 12;
+
+static size_t alignSection(size_t offset) { return (offset + SECTION_ALIGN - 1) & ~(SECTION_ALIGN - 1); }
+
+static uint32_t byteSwap(uint32_t value)
+{
+	return (value >> 24) | ((value >> 8) & 0xff00) | ((value << 8) & 0xff0000) | (value << 24);
+}
+
+/*
+ * The devices section is the device count, padded to 8 bytes, followed by
+ * the ImageDevice entries and their zero terminated ids.
+ */
+static std::vector<char> buildDevices(const std::vector<XmlDevice>& xmlDevices)
+{
+	std::vector<ImageDevice> devices;
+	std::string names;
+
+	size_t entries = SECTION_ALIGN + xmlDevices.size() * sizeof(ImageDevice);
+	for (const auto& xmlDevice : xmlDevices) {
+		ImageDevice device = {};
+		device.name = static_cast<uint32_t>(entries + names.size());
+		device.flags = xmlDevice.flags;
+		devices.push_back(device);
+		names.append(xmlDevice.id);
+		names.push_back('\0');
+	}
+
+	std::vector<char> section(entries + names.size());
+	auto count = static_cast<uint32_t>(devices.size());
+	memcpy(section.data(), &count, sizeof(count));
+	if (count > 0) {
+		memcpy(section.data() + SECTION_ALIGN, devices.data(), devices.size() * sizeof(ImageDevice));
+	}
+	memcpy(section.data() + entries, names.data(), names.size());
+	return section;
+}
+
+ContextImage::ContextImage()
+	: m_data(nullptr)
+	, m_size(0)
+	, m_map(nullptr)
+	, m_mapSize(0)
+	, m_buffer(nullptr)
+{}
+
+ContextImage::~ContextImage()
+{
+#if !defined(_WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
+	if (m_map) {
+		munmap(m_map, m_mapSize);
+		m_map = nullptr;
+	}
+#endif
+	delete[] m_buffer;
+	m_buffer = nullptr;
+}
+
+int ContextImage::open(const void* data, size_t size)
+{
+	m_data = static_cast<const char*>(data);
+	m_size = size;
+	return validate();
+}
+
+int ContextImage::open(const char* path)
+{
+#if !defined(_WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
+	int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		int ret = -errno;
+		Logger::log(IIO_EMU_ERROR, {"Cannot open the context image ", path, ": ", strerror(errno)});
+		return ret;
+	}
+
+	struct stat st = {};
+	if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+		::close(fd);
+		Logger::log(IIO_EMU_ERROR, {"Invalid context image ", path});
+		return -EINVAL;
+	}
+
+	// the pages stay in the page cache, shared by the instances using the image
+	m_mapSize = static_cast<size_t>(st.st_size);
+	void* addr = mmap(nullptr, m_mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (addr == MAP_FAILED) {
+		int ret = -errno;
+		Logger::log(IIO_EMU_ERROR, {"Cannot map the context image ", path, ": ", strerror(errno)});
+		return ret;
+	}
+	m_map = addr;
+	return open(m_map, m_mapSize);
+#else
+	std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file.is_open()) {
+		Logger::log(IIO_EMU_ERROR, {"Cannot open the context image ", path});
+		return -ENOENT;
+	}
+
+	auto size = static_cast<size_t>(file.tellg());
+	file.seekg(0);
+	// allocated as 64 bit words, for the alignment of the sections
+	m_buffer = new uint64_t[(size + sizeof(uint64_t) - 1) / sizeof(uint64_t)];
+	if (!file.read(reinterpret_cast<char*>(m_buffer), static_cast<std::streamsize>(size))) {
+		Logger::log(IIO_EMU_ERROR, {"Cannot read the context image ", path});
+		return -EIO;
+	}
+	return open(m_buffer, size);
+#endif
+}
+
+const void* ContextImage::getSection(ImageSectionId id, size_t* size) const
+{
+	auto header = reinterpret_cast<const ImageHeader*>(m_data);
+	const ImageSection& section = header->sections[id];
+
+	*size = static_cast<size_t>(section.size);
+	if (section.size == 0) {
+		return nullptr;
+	}
+	return m_data + section.offset;
+}
+
+ssize_t ContextImage::getXml(const char** xml) const
+{
+	size_t size;
+	*xml = static_cast<const char*>(getSection(IMAGE_SECTION_XML, &size));
+	return static_cast<ssize_t>(size) - 1;
+}
+
+ssize_t ContextImage::getCompressedXml(const char** zxml) const
+{
+	size_t size;
+	*zxml = static_cast<const char*>(getSection(IMAGE_SECTION_ZXML, &size));
+	if (*zxml == nullptr) {
+		return -ENOSYS;
+	}
+	return static_cast<ssize_t>(size);
+}
+
+int ContextImage::getDeviceFlags(const char* device_id) const
+{
+	size_t size;
+	auto section = static_cast<const char*>(getSection(IMAGE_SECTION_DEVICES, &size));
+
+	uint32_t count;
+	memcpy(&count, section, sizeof(count));
+	auto devices = reinterpret_cast<const ImageDevice*>(section + SECTION_ALIGN);
+	for (uint32_t i = 0; i < count; i++) {
+		if (!strcmp(section + devices[i].name, device_id)) {
+			return static_cast<int>(devices[i].flags);
+		}
+	}
+	return -ENOENT;
+}
+
+bool ContextImage::isImage(const char* path)
+{
+	std::ifstream file(path, std::ios::in | std::ios::binary);
+	uint32_t magic = 0;
+	if (!file.read(reinterpret_cast<char*>(&magic), sizeof(magic))) {
+		return false;
+	}
+	return magic == MAGIC || magic == byteSwap(MAGIC);
+}
+
+int ContextImage::validate()
+{
+	auto header = reinterpret_cast<const ImageHeader*>(m_data);
+
+	if (m_size < sizeof(ImageHeader) || reinterpret_cast<uintptr_t>(m_data) % SECTION_ALIGN) {
+		Logger::log(IIO_EMU_ERROR, {"Invalid context image"});
+		return -EINVAL;
+	}
+	if (header->magic == byteSwap(MAGIC) || header->byteOrder != BYTE_ORDER_MARK) {
+		Logger::log(IIO_EMU_ERROR, {"The context image was compiled for a different byte order"});
+		return -EINVAL;
+	}
+	if (header->magic != MAGIC || header->version != VERSION || header->size != m_size) {
+		Logger::log(IIO_EMU_ERROR, {"Invalid or unsupported context image"});
+		return -EINVAL;
+	}
+
+	for (const auto& section : header->sections) {
+		if (section.offset % SECTION_ALIGN || section.offset > m_size || section.size > m_size - section.offset) {
+			Logger::log(IIO_EMU_ERROR, {"Context image section out of bounds"});
+			return -EINVAL;
+		}
+	}
+
+	/*
+	 * the tables are used in place, anything that would make the attribute
+	 * store read outside of the image is rejected here
+	 */
+	size_t namesSize, recordsSize, bucketsSize, valuesSize, devicesSize, xmlSize;
+	auto names = static_cast<const char*>(getSection(IMAGE_SECTION_NAMES, &namesSize));
+	auto records = static_cast<const AttrStore::Record*>(getSection(IMAGE_SECTION_RECORDS, &recordsSize));
+	auto buckets = static_cast<const uint32_t*>(getSection(IMAGE_SECTION_BUCKETS, &bucketsSize));
+	auto values = static_cast<const char*>(getSection(IMAGE_SECTION_VALUES, &valuesSize));
+	auto devices = static_cast<const char*>(getSection(IMAGE_SECTION_DEVICES, &devicesSize));
+	auto xml = static_cast<const char*>(getSection(IMAGE_SECTION_XML, &xmlSize));
+
+	size_t count = recordsSize / sizeof(AttrStore::Record);
+	size_t bucketCount = bucketsSize / sizeof(uint32_t);
+	bool valid = names && names[namesSize - 1] == '\0' && recordsSize % sizeof(AttrStore::Record) == 0 &&
+		     bucketsSize % sizeof(uint32_t) == 0 && bucketCount > count && !(bucketCount & (bucketCount - 1)) &&
+		     xml && xml[xmlSize - 1] == '\0' && devices && devicesSize >= SECTION_ALIGN;
+
+	for (size_t i = 0; valid && i < count; i++) {
+		const AttrStore::Record& record = records[i];
+		valid = record.device < namesSize && record.channel < namesSize && record.name < namesSize &&
+			record.scope <= ATTR_SCOPE_CONTEXT && record.valueLength < record.valueCapacity &&
+			!(record.valueOffset % sizeof(uint32_t)) && !(record.valueCapacity % sizeof(uint32_t)) &&
+			record.valueOffset <= valuesSize && record.valueCapacity <= valuesSize - record.valueOffset &&
+			values[record.valueOffset + record.valueLength] == '\0';
+	}
+	// with each record in one bucket at most, a bucket stays empty and ends the lookups that miss
+	std::vector<bool> indexed(valid ? count : 0);
+	for (size_t i = 0; valid && i < bucketCount; i++) {
+		valid = buckets[i] <= count && (buckets[i] == 0 || !indexed[buckets[i] - 1]);
+		if (valid && buckets[i] != 0) {
+			indexed[buckets[i] - 1] = true;
+		}
+	}
+
+	if (valid) {
+		uint32_t deviceCount;
+		memcpy(&deviceCount, devices, sizeof(deviceCount));
+		size_t entries = SECTION_ALIGN + static_cast<size_t>(deviceCount) * sizeof(ImageDevice);
+		valid = entries <= devicesSize && (deviceCount == 0 || devices[devicesSize - 1] == '\0');
+
+		auto entry = reinterpret_cast<const ImageDevice*>(devices + SECTION_ALIGN);
+		for (uint32_t i = 0; valid && i < deviceCount; i++) {
+			valid = entry[i].name >= entries && entry[i].name < devicesSize;
+		}
+	}
+
+	if (!valid) {
+		Logger::log(IIO_EMU_ERROR, {"Corrupted context image"});
+		return -EINVAL;
+	}
+	return 0;
+}
+
+int ContextImage::load(const char* path)
+{
+	AttrStore store;
+	std::vector<XmlDevice> devices;
+	std::string xml;
+
+	int ret = streamXml(path, &store, &devices, &xml);
+	if (ret < 0) {
+		Logger::log(IIO_EMU_ERROR, {"Cannot read the context ", path});
+		return ret;
+	}
+	return build(store, devices, xml);
+}
+
+int ContextImage::load(const char* data, size_t size)
+{
+	AttrStore store;
+	std::vector<XmlDevice> devices;
+	std::string xml;
+
+	int ret = streamXml(data, size, &store, &devices, &xml);
+	if (ret < 0) {
+		Logger::log(IIO_EMU_ERROR, {"Cannot read the context"});
+		return ret;
+	}
+	return build(store, devices, xml);
+}
+
+int ContextImage::build(const AttrStore& store, const std::vector<XmlDevice>& xmlDevices, const std::string& xml)
+{
+	char* zxml = nullptr;
+	ssize_t zxmlSize = iio_emu::compressXml(xml.c_str(), xml.size(), &zxml);
+	std::vector<char> devices = buildDevices(xmlDevices);
+
+	const void* data[IMAGE_SECTION_COUNT] = {};
+	ImageHeader header = {};
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.byteOrder = BYTE_ORDER_MARK;
+
+	data[IMAGE_SECTION_NAMES] = store.m_names;
+	header.sections[IMAGE_SECTION_NAMES].size = store.m_namesSize;
+	data[IMAGE_SECTION_RECORDS] = store.m_records;
+	header.sections[IMAGE_SECTION_RECORDS].size = store.m_count * sizeof(AttrStore::Record);
+	data[IMAGE_SECTION_BUCKETS] = store.m_buckets;
+	header.sections[IMAGE_SECTION_BUCKETS].size = (store.m_mask + 1) * sizeof(uint32_t);
+	std::vector<char> values(store.m_valuesSize);
+	store.copyValues(values.data());
+	data[IMAGE_SECTION_VALUES] = values.data();
+	header.sections[IMAGE_SECTION_VALUES].size = store.m_valuesSize;
+	data[IMAGE_SECTION_DEVICES] = devices.data();
+	header.sections[IMAGE_SECTION_DEVICES].size = devices.size();
+	// with the terminating zero, like the XML served by the contexts
+	data[IMAGE_SECTION_XML] = xml.c_str();
+	header.sections[IMAGE_SECTION_XML].size = xml.size() + 1;
+	data[IMAGE_SECTION_ZXML] = zxml;
+	header.sections[IMAGE_SECTION_ZXML].size = zxmlSize > 0 ? static_cast<uint64_t>(zxmlSize) : 0;
+
+	size_t offset = alignSection(sizeof(ImageHeader));
+	for (auto& section : header.sections) {
+		section.offset = offset;
+		offset = alignSection(offset + section.size);
+	}
+	header.size = offset;
+
+	// allocated as 64 bit words, for the alignment of the sections
+	m_buffer = new uint64_t[offset / sizeof(uint64_t)]();
+	auto buf = reinterpret_cast<char*>(m_buffer);
+	memcpy(buf, &header, sizeof(header));
+	for (int i = 0; i < IMAGE_SECTION_COUNT; i++) {
+		if (header.sections[i].size) {
+			memcpy(buf + header.sections[i].offset, data[i], header.sections[i].size);
+		}
+	}
+	delete[] zxml;
+
+	return open(m_buffer, offset);
+}
+
+int ContextImage::save(const char* path) const
+{
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	file.write(m_data, static_cast<std::streamsize>(m_size));
+	file.close();
+
+	if (!file) {
+		Logger::log(IIO_EMU_ERROR, {"Cannot write the context image ", path});
+		return -EIO;
+	}
+	return 0;
+}
+
+int ContextImage::saveHeader(const char* path, const char* name) const
+{
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+	// the sections are used in place, the array keeps the image alignment
+	file << "alignas(8) static const unsigned char " << name << "[] =\n{\n";
+	for (size_t i = 0; i < m_size; i++) {
+		char byte[8];
+		snprintf(byte, sizeof(byte), "0x%02x,", static_cast<unsigned char>(m_data[i]));
+		file << (i % HEADER_LINE_BYTES ? " " : "\t") << byte;
+		if (i % HEADER_LINE_BYTES == HEADER_LINE_BYTES - 1 || i == m_size - 1) {
+			file << "\n";
+		}
+	}
+	file << "};\n";
+	file.close();
+
+	if (!file) {
+		Logger::log(IIO_EMU_ERROR, {"Cannot write the context header ", path});
+		return -EIO;
+	}
+	return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * ADIBSD License
+ *
+ * Copyright (c) 2021 Analog Devices Inc.
+ * All rights reserved.
+ *
+ * This file is part of iio-emu
+ * (see http://www.github.com/analogdevicesinc/iio-emu).
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *     - Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     - Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     - Neither the name of Analog Devices, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *     - The use of this software may or may not infringe the patent rights
+ *       of one or more patent holders.  This license does not release you
+ *       from the requirement that you obtain separate licenses from these
+ *       patent holders to use this software.
+ *     - Use of the software either in source or binary form, must be run
+ *       on or directly connected to an Analog Devices Inc. component.
+ *
+ * THIS SOFTWARE IS PROVIDED BY ANALOG DEVICES "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.
+ *
+ * IN NO EVENT SHALL ANALOG DEVICES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, INTELLECTUAL PROPERTY
+ * RIGHTS, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IIO_EMU_CONTEXT_IMAGE_HPP
+#define IIO_EMU_CONTEXT_IMAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <tinyiiod/compat.h>
+#include <vector>
+
+namespace iio_emu {
+
+class AttrStore;
+struct XmlDevice;
+
+enum ImageSectionId
+{
+	// interned device, channel and attribute names
+	IMAGE_SECTION_NAMES = 0,
+	// attribute records, in document order
+	IMAGE_SECTION_RECORDS = 1,
+	// hash index of the records
+	IMAGE_SECTION_BUCKETS = 2,
+	// initial attribute values
+	IMAGE_SECTION_VALUES = 3,
+	// devices with their buffer capabilities
+	IMAGE_SECTION_DEVICES = 4,
+	// client XML, as served by PRINT
+	IMAGE_SECTION_XML = 5,
+	// zstd frame of the client XML, empty when compiled without zstd
+	IMAGE_SECTION_ZXML = 6,
+	IMAGE_SECTION_COUNT = 7
+};
+
+struct ImageSection
+{
+	uint64_t offset;
+	uint64_t size;
+};
+
+/*
+ * Layout of a context image. The sections follow the header, each one
+ * aligned to 8 bytes. All the fields are in the byte order of the machine
+ * that compiled the image and the offsets are relative to the image start.
+ */
+struct ImageHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t reserved;
+	uint64_t size;
+	ImageSection sections[IMAGE_SECTION_COUNT];
+};
+
+struct ImageDevice
+{
+	// offset of the device id in the devices section
+	uint32_t name;
+	uint32_t flags;
+};
+
+/*
+ * Compiled form of an emulator context. The image holds the attribute index
+ * and the initial values of the AttrStore and the pre-rendered client XML.
+ * Contexts are served from images: either compiled ahead of time, so the
+ * document is not read at all, or compiled at startup while the document
+ * is streamed. Image files are mapped read only, so their pages are shared
+ * by all the instances serving the same context.
+ */
+class ContextImage
+{
+public:
+	static constexpr uint32_t MAGIC = 0x49434549; // "IECI"
+	static constexpr uint32_t VERSION = 1;
+	static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+	enum DeviceFlags
+	{
+		// one of the channels has a scan element
+		DEVICE_SCAN = 1,
+		// all the channels are outputs
+		DEVICE_OUTPUT = 2
+	};
+
+	ContextImage();
+	~ContextImage();
+
+	ContextImage(const ContextImage&) = delete;
+	ContextImage& operator=(const ContextImage&) = delete;
+
+	// the memory is borrowed and must be aligned to 8 bytes
+	int open(const void* data, size_t size);
+	int open(const char* path);
+
+	// compiles a context document, from a file or from memory
+	int load(const char* path);
+	int load(const char* data, size_t size);
+
+	// the section data and size, nullptr when the section is empty
+	const void* getSection(ImageSectionId id, size_t* size) const;
+
+	// returns the XML length, without the terminating zero
+	ssize_t getXml(const char** xml) const;
+	// returns the length of the zstd frame, -ENOSYS when the image has none
+	ssize_t getCompressedXml(const char** zxml) const;
+
+	// DeviceFlags of the device, -ENOENT when the device is unknown
+	int getDeviceFlags(const char* device_id) const;
+
+	// checks the magic number of the file
+	static bool isImage(const char* path);
+
+	// writes the image, to a binary file or to a C header defining the array name
+	int save(const char* path) const;
+	int saveHeader(const char* path, const char* name) const;
+
+private:
+	int validate();
+
+	int build(const AttrStore& store, const std::vector<XmlDevice>& devices, const std::string& xml);
+
+private:
+	const char* m_data;
+	size_t m_size;
+
+	// set when the image is mapped from a file
+	void* m_map;
+	size_t m_mapSize;
+	uint64_t* m_buffer;
+};
+} // namespace iio_emu
+
+#endif // IIO_EMU_CONTEXT_IMAGE_HPP
@@ -41,6 +41,8 @@
 
 using namespace iio_emu;
 
+constexpr const char* CYCLIC_OPTION = ":cyclic";
+
 const char* InputParser::getXMLPath(std::vector<const char*>& args)
 {
 	for (auto arg : args) {
@@ -64,3 +66,29 @@ std::vector<std::pair<const std::string, const std::string>> InputParser::getDev
 	}
 	return devices;
 }
+
+std::vector<std::pair<const std::string, const std::string>>
+InputParser::getLoopbacks(std::vector<const char*>& args)
+{
+	std::vector<std::pair<const std::string, const std::string>> loopbacks;
+
+	for (auto arg : args) {
+		std::string str(arg);
+		auto index = str.find('<');
+		if (index != std::string::npos && str.find('@') == std::string::npos) {
+			loopbacks.emplace_back(str.substr(0, index), str.substr(index + 1));
+		}
+	}
+	return loopbacks;
+}
+
+bool InputParser::takeCyclicOption(std::string& filePath)
+{
+	std::string option(CYCLIC_OPTION);
+	if (filePath.size() <= option.size() ||
+	    filePath.compare(filePath.size() - option.size(), option.size(), option) != 0) {
+		return false;
+	}
+	filePath.erase(filePath.size() - option.size());
+	return true;
+}
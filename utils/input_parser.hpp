@@ -52,6 +52,12 @@ public:
 	static const char* getXMLPath(std::vector<const char*>& args);
 
 	static std::vector<std::pair<const std::string, const std::string>> getDevices(std::vector<const char*>& args);
+
+	// <rx_device_id><<tx_device_id> arguments, as (RX, TX) pairs
+	static std::vector<std::pair<const std::string, const std::string>> getLoopbacks(std::vector<const char*>& args);
+
+	// removes the ":cyclic" suffix of a device file, returns whether it was present
+	static bool takeCyclicOption(std::string& filePath);
 };
 } // namespace iio_emu
 
@@ -39,16 +39,13 @@
 
 #include "network_ops.hpp"
 
+#include "iiod/ops/session.hpp"
 #include "networking/abstract_socket.hpp"
 #include "utils/logger.hpp"
 
-#include <cstring>
-
-ssize_t iio_emu::socket_read(AbstractSocket* socket, void* buf, size_t len)
+ssize_t iio_emu::socket_read(Session& session, void* buf, size_t len)
 {
-	char dataReceived[IIOD_BUFFER_SIZE];
-	auto size = socket->getData(len, dataReceived);
-	memcpy(buf, dataReceived, size);
-	Logger::log(IIO_EMU_DEBUG, {"Socket read data: ", dataReceived});
+	auto size = session.getSocket()->getData(len, static_cast<char*>(buf));
+	Logger::log(IIO_EMU_DEBUG, {"Socket read data: ", std::to_string(size)});
 	return static_cast<ssize_t>(size);
 }
@@ -44,8 +44,8 @@
 
 namespace iio_emu {
 
-class AbstractSocket;
+class Session;
 
-ssize_t socket_read(AbstractSocket* socket, void* buf, size_t len);
+ssize_t socket_read(Session& session, void* buf, size_t len);
 } // namespace iio_emu
 #endif // IIO_EMU_NETWORK_OPS_HPP
@@ -39,13 +39,111 @@
 
 #include "utility.hpp"
 
+#include <locale>
 #include <sstream>
 
+// powers of ten which are exactly representable as doubles
+static const double EXACT_POWERS_OF_TEN[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+					     1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+constexpr int MAX_EXACT_POWER = 22;
+constexpr uint64_t MAX_EXACT_MANTISSA = 1ULL << 53;
+constexpr int MAX_MANTISSA_DIGITS = 19;
+
+static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+static bool isSpace(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
 double iio_emu::safe_stod(const std::string& value)
 {
 	double converted_value = 0.0;
-	std::istringstream in_s(value);
-	in_s.imbue(std::locale("C"));
-	in_s >> converted_value;
+	parse_number(value.c_str(), value.size(), &converted_value);
 	return converted_value;
 }
+
+bool iio_emu::parse_number(const char* str, size_t len, double* value)
+{
+	const char* p = str;
+	const char* end = str + len;
+
+	while (p < end && isSpace(*p)) {
+		p++;
+	}
+	const char* start = p;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = (*p == '-');
+		p++;
+	}
+
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool found = false;
+
+	for (; p < end && isDigit(*p); p++) {
+		found = true;
+		if (digits < MAX_MANTISSA_DIGITS) {
+			mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+			digits += (mantissa != 0);
+		} else {
+			exponent++;
+		}
+	}
+
+	if (p < end && *p == '.') {
+		for (p++; p < end && isDigit(*p); p++) {
+			found = true;
+			if (digits < MAX_MANTISSA_DIGITS) {
+				mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+				digits += (mantissa != 0);
+				exponent--;
+			}
+		}
+	}
+
+	if (!found) {
+		return false;
+	}
+
+	// the exponent is only consumed when it has digits, as strtod does
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		const char* q = p + 1;
+		bool negativeExp = false;
+		if (q < end && (*q == '-' || *q == '+')) {
+			negativeExp = (*q == '-');
+			q++;
+		}
+		if (q < end && isDigit(*q)) {
+			int exp = 0;
+			for (; q < end && isDigit(*q); q++) {
+				if (exp < 100000) {
+					exp = exp * 10 + (*q - '0');
+				}
+			}
+			exponent += negativeExp ? -exp : exp;
+			p = q;
+		}
+	}
+
+	if (mantissa > MAX_EXACT_MANTISSA || exponent < -MAX_EXACT_POWER || exponent > MAX_EXACT_POWER) {
+		// long or huge values are rare enough to take the slow path
+		double result = 0.0;
+		std::istringstream in_s(std::string(start, p));
+		in_s.imbue(std::locale::classic());
+		in_s >> result;
+		*value = result;
+		return true;
+	}
+
+	// both operands are exact, so the single rounding gives the correctly rounded value
+	double result = static_cast<double>(mantissa);
+	if (exponent < 0) {
+		result /= EXACT_POWERS_OF_TEN[-exponent];
+	} else {
+		result *= EXACT_POWERS_OF_TEN[exponent];
+	}
+
+	*value = negative ? -result : result;
+	return true;
+}
@@ -58,6 +58,12 @@ constexpr uint8_t BYTE_SIZE = 8;
 
 double safe_stod(const std::string& value);
 
+/*
+ * locale independent conversion of the number at the start of str, like strtod
+ * in the "C" locale; returns false when str does not start with a number
+ */
+bool parse_number(const char* str, size_t len, double* value);
+
 template <typename T>
 void analogical_decimation(const std::vector<T>& src, std::vector<T>& dest, unsigned int ratio)
 {
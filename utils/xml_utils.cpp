@@ -38,183 +38,535 @@
  */
 
 #include "xml_utils.hpp"
+#include "attr_store.hpp"
+#include "context_image.hpp"
+#include "utility.hpp"
 
-#include <algorithm>
-#include <libxml/tree.h>
+#include <cstring>
+#include <libxml/SAX2.h>
+#include <libxml/parserInternals.h>
+#include <libxml/xmlreader.h>
 #include <string>
-#include <vector>
+
+#if defined(IIO_EMU_ZSTD)
+#include <zstd.h>
+#endif
 
 using namespace iio_emu;
 
-struct _xmlNode* iio_emu::getNode(struct _xmlNode* root, const char* node_name, const char* attr_name,
-				  const char* attr_value)
+namespace {
+/*
+ * Accumulates the serialized context the way clients receive it: without
+ * line breaks and with runs of spaces collapsed into one
+ */
+class XmlWriter
 {
-	xmlNode* node = nullptr;
-	xmlAttr* attr = nullptr;
-
-	for (node = root->children; node; node = node->next) {
-		if (!strcmp(reinterpret_cast<const char*>(node->name), node_name)) {
-			for (attr = node->properties; attr; attr = attr->next) {
-				if (!strcmp(reinterpret_cast<const char*>(attr->name), attr_name)) {
-					if (!strcmp(reinterpret_cast<const char*>(attr->children->content),
-						    attr_value)) {
-						return node;
-					}
-				}
-			}
+public:
+	explicit XmlWriter(size_t reserve) { m_out.reserve(reserve); }
+
+	void put(char c)
+	{
+		if (c == '\n' || (c == ' ' && !m_out.empty() && m_out.back() == ' ')) {
+			return;
 		}
+		m_out.push_back(c);
 	}
-	return nullptr;
-}
 
-struct _xmlNode* iio_emu::getNode(struct _xmlNode* root, const char* node_name)
-{
-	xmlNode* node = nullptr;
-
-	for (node = root->children; node; node = node->next) {
-		if (!strcmp(reinterpret_cast<const char*>(node->name), node_name)) {
-			return node;
+	void put(const char* str)
+	{
+		for (; str && *str; str++) {
+			put(*str);
 		}
 	}
-	return nullptr;
-}
 
-static xmlNode* getNodeNAttrs(xmlNode* root, const char* node_name, const char** attr_name, const char** attr_value,
-			      size_t len)
-{
-	xmlNode* node = nullptr;
-	xmlAttr* attr[IIOD_BUFFER_SIZE];
-	for (node = root->children; node; node = node->next) {
-	search_node:
-		if (!strcmp(reinterpret_cast<const char*>(node->name), node_name)) {
-			for (size_t i = 0; i < len; i++) {
-				for (attr[i] = node->properties; attr[i]; attr[i] = attr[i]->next) {
-					if (!strcmp(reinterpret_cast<const char*>(attr[i]->name), attr_name[i])) {
-						if (strcmp(reinterpret_cast<const char*>(attr[i]->children->content),
-							   attr_value[i]) != 0) {
-							node = node->next;
-							goto search_node;
-						}
-					}
-				}
+	void put(const xmlChar* str) { put(reinterpret_cast<const char*>(str)); }
+
+	// escapes as libxml does for attribute values and text content
+	void putEscaped(const xmlChar* str, size_t len, bool attribute)
+	{
+		for (const xmlChar* end = str + len; str < end; str++) {
+			switch (*str) {
+			case '<':
+				put("&lt;");
+				break;
+			case '>':
+				put("&gt;");
+				break;
+			case '&':
+				put("&amp;");
+				break;
+			case '"':
+				attribute ? put("&quot;") : put('"');
+				break;
+			case '\n':
+				attribute ? put("&#10;") : put('\n');
+				break;
+			case '\t':
+				attribute ? put("&#9;") : put('\t');
+				break;
+			case '\r':
+				put("&#13;");
+				break;
+			default:
+				put(static_cast<char>(*str));
+				break;
 			}
-			return node;
 		}
 	}
-	return nullptr;
-}
 
-xmlNode* iio_emu::getDeviceAttr(xmlDoc* doc, const char* dev, enum iio_attr_type type, const char* attr)
+	void putEscaped(const std::string& str, bool attribute)
+	{
+		putEscaped(reinterpret_cast<const xmlChar*>(str.data()), str.size(), attribute);
+	}
+
+	std::string& str() { return m_out; }
+
+private:
+	std::string m_out;
+};
+} // namespace
+
+static void putDtd(XmlWriter& out, xmlDtd* dtd)
 {
-	xmlNode *root, *node_device, *node_attr;
-
-	if (!doc) {
-		return nullptr;
-	}
-	root = xmlDocGetRootElement(doc);
-	if (root == nullptr) {
-		return nullptr;
-	}
-	node_device = getNode(root, "device", "id", dev);
-	if (node_device == nullptr) {
-		return nullptr;
-	}
-	switch (type) {
-	case IIO_ATTR_TYPE_DEVICE:
-		node_attr = getNode(node_device, "attribute", "name", attr);
-		break;
-	case IIO_ATTR_TYPE_DEBUG:
-		node_attr = getNode(node_device, "debug-attribute", "name", attr);
-		break;
-	case IIO_ATTR_TYPE_BUFFER:
-		node_attr = getNode(node_device, "buffer-attribute", "name", attr);
-		break;
-	}
-	return node_attr;
+	// the declarations are kept as written, libxml prints them
+	xmlBuffer* buf = xmlBufferCreate();
+	if (buf == nullptr) {
+		return;
+	}
+	xmlNodeDump(buf, dtd->doc, reinterpret_cast<xmlNode*>(dtd), 0, 0);
+	out.put(xmlBufferContent(buf));
+	xmlBufferFree(buf);
 }
 
-xmlNode* iio_emu::getChannelAttr(xmlDoc* doc, const char* chn, const char* dev, const char* attr, bool ch_out)
+namespace {
+/*
+ * SAX handler following the context document. Only the position in the
+ * context -> device -> channel hierarchy is kept, no tree is built; the
+ * default libxml handlers still collect the DTD, which is printed as is.
+ */
+class ContextStream
 {
+public:
+	ContextStream(xmlParserCtxt* ctxt, AttrStore* store, std::vector<XmlDevice>* devices)
+		: m_ctxt(ctxt)
+		, m_store(store)
+		, m_devices(devices)
+		, m_out(4096)
+		, m_depth(0)
+		, m_pending(false)
+		, m_root(false)
+		, m_device(false)
+		, m_channel(false)
+		, m_channelAttrs(false)
+		, m_output(false)
+	{
+		xmlSAXHandler* sax = m_ctxt->sax;
+		xmlSAXVersion(sax, 2);
+		sax->startElementNs = startElement;
+		sax->endElementNs = endElement;
+		sax->characters = characters;
+		// blanks are kept, as in a document tree
+		sax->ignorableWhitespace = characters;
+		sax->cdataBlock = cdataBlock;
+		sax->comment = comment;
+		sax->processingInstruction = processingInstruction;
+		sax->reference = reference;
+		m_ctxt->_private = this;
+	}
+
+	int run(std::string* xml)
+	{
+		xmlParseDocument(m_ctxt);
+		if (!m_ctxt->wellFormed) {
+			return -EINVAL;
+		}
+		if (!m_root) {
+			return -ENOENT;
+		}
 
-	xmlNode *root, *node_device, *node_channel, *node_attr;
+		// same rules as GenericXmlContext used on the document
+		for (size_t i = 0; i < m_devices->size(); i++) {
+			uint32_t& flags = (*m_devices)[i].flags;
+			if (!(flags & ContextImage::DEVICE_SCAN)) {
+				flags = 0;
+			} else if (m_hasInput[i]) {
+				flags = ContextImage::DEVICE_SCAN;
+			} else {
+				flags = ContextImage::DEVICE_SCAN | ContextImage::DEVICE_OUTPUT;
+			}
+		}
 
-	if (doc == nullptr) {
-		return nullptr;
+		// the declaration and the DTD are complete only at the end of the document
+		XmlWriter head(1024);
+		xmlDoc* doc = m_ctxt->myDoc;
+		head.put("<?xml version=\"");
+		head.put(doc->version ? doc->version : reinterpret_cast<const xmlChar*>("1.0"));
+		head.put('"');
+		if (doc->encoding) {
+			head.put(" encoding=\"");
+			head.put(doc->encoding);
+			head.put('"');
+		}
+		head.put("?>");
+		if (doc->intSubset) {
+			putDtd(head, doc->intSubset);
+		}
+
+		xml->swap(head.str());
+		xml->append(m_out.str());
+		return 0;
 	}
-	const char* output = ch_out ? "output" : "input";
-	const char* attrs_name[] = {"id", "type"};
-	const char* attrs_values[] = {chn, output};
-	root = xmlDocGetRootElement(doc);
-	if (root == nullptr) {
-		return nullptr;
+
+private:
+	// the entity contents are parsed by nested parsers, their events are not part of the document
+	static ContextStream* get(void* ctx)
+	{
+		auto ctxt = static_cast<xmlParserCtxt*>(ctx);
+		auto stream = static_cast<ContextStream*>(ctxt->_private);
+		return stream && stream->m_ctxt == ctxt ? stream : nullptr;
 	}
-	node_device = getNode(root, "device", "id", dev);
-	if (node_device == nullptr) {
-		return nullptr;
+
+	static void startElement(void* ctx, const xmlChar* localname, const xmlChar* prefix, const xmlChar* URI,
+				 int nb_namespaces, const xmlChar** namespaces, int nb_attributes, int nb_defaulted,
+				 const xmlChar** attributes)
+	{
+		UNUSED(URI);
+		UNUSED(nb_namespaces);
+		UNUSED(namespaces);
+		UNUSED(nb_defaulted);
+
+		ContextStream* stream = get(ctx);
+		if (stream) {
+			stream->putElement(localname, prefix, nb_attributes, attributes);
+		}
 	}
-	node_channel = getNodeNAttrs(node_device, "channel", attrs_name, attrs_values, 2);
-	if (node_channel == nullptr) {
-		return nullptr;
+
+	static void endElement(void* ctx, const xmlChar* localname, const xmlChar* prefix, const xmlChar* URI)
+	{
+		UNUSED(URI);
+
+		ContextStream* stream = get(ctx);
+		if (stream == nullptr) {
+			return;
+		}
+
+		stream->m_depth--;
+		if (stream->m_pending) {
+			stream->m_out.put("/>");
+			stream->m_pending = false;
+		} else {
+			stream->m_out.put("</");
+			stream->putName(prefix, localname);
+			stream->m_out.put('>');
+		}
 	}
-	node_attr = getNode(node_channel, "attribute", "name", attr);
-	return node_attr;
-}
 
-static void removeValueAttribute(struct _xmlNode* node)
-{
-	if (node == nullptr) {
-		return;
+	static void characters(void* ctx, const xmlChar* ch, int len)
+	{
+		ContextStream* stream = get(ctx);
+		if (stream) {
+			stream->closeStartTag();
+			stream->m_out.putEscaped(ch, static_cast<size_t>(len), false);
+		}
+	}
+
+	static void cdataBlock(void* ctx, const xmlChar* value, int len)
+	{
+		ContextStream* stream = get(ctx);
+		if (stream) {
+			stream->closeStartTag();
+			stream->m_out.put("<![CDATA[");
+			std::string text(reinterpret_cast<const char*>(value), static_cast<size_t>(len));
+			stream->m_out.put(text.c_str());
+			stream->m_out.put("]]>");
+		}
+	}
+
+	static void comment(void* ctx, const xmlChar* value)
+	{
+		auto ctxt = static_cast<xmlParserCtxt*>(ctx);
+		ContextStream* stream = get(ctx);
+		if (stream == nullptr || ctxt->inSubset) {
+			// the comments of the DTD are printed with it
+			xmlSAX2Comment(ctx, value);
+			return;
+		}
+
+		stream->closeStartTag();
+		stream->m_out.put("<!--");
+		stream->m_out.put(value);
+		stream->m_out.put("-->");
+	}
+
+	static void processingInstruction(void* ctx, const xmlChar* target, const xmlChar* data)
+	{
+		auto ctxt = static_cast<xmlParserCtxt*>(ctx);
+		ContextStream* stream = get(ctx);
+		if (stream == nullptr || ctxt->inSubset) {
+			xmlSAX2ProcessingInstruction(ctx, target, data);
+			return;
+		}
+
+		stream->closeStartTag();
+		stream->m_out.put("<?");
+		stream->m_out.put(target);
+		if (data) {
+			stream->m_out.put(' ');
+			stream->m_out.put(data);
+		}
+		stream->m_out.put("?>");
+	}
+
+	static void reference(void* ctx, const xmlChar* name)
+	{
+		ContextStream* stream = get(ctx);
+		if (stream) {
+			stream->closeStartTag();
+			stream->m_out.put('&');
+			stream->m_out.put(name);
+			stream->m_out.put(';');
+		}
+	}
+
+	void putName(const xmlChar* prefix, const xmlChar* name)
+	{
+		if (prefix) {
+			m_out.put(prefix);
+			m_out.put(':');
+		}
+		m_out.put(name);
+	}
+
+	// an element without children is closed as an empty one
+	void closeStartTag()
+	{
+		if (m_pending) {
+			m_out.put('>');
+			m_pending = false;
+		}
+	}
+
+	/*
+	 * Without entity substitution, libxml leaves "&#38;" for '&' and the
+	 * references to the other entities in the attribute values; they are
+	 * replaced as a document tree would have them.
+	 */
+	std::string decodeValue(const xmlChar* begin, const xmlChar* end)
+	{
+		std::string value;
+		for (const xmlChar* c = begin; c < end; c++) {
+			if (*c != '&') {
+				value.push_back(static_cast<char>(*c));
+				continue;
+			}
+
+			const xmlChar* semicolon = c;
+			while (semicolon < end && *semicolon != ';') {
+				semicolon++;
+			}
+			std::string name(reinterpret_cast<const char*>(c + 1), static_cast<size_t>(semicolon - c - 1));
+			if (name == "#38") {
+				value.push_back('&');
+			} else {
+				xmlEntity* entity =
+					xmlGetDocEntity(m_ctxt->myDoc, reinterpret_cast<const xmlChar*>(name.c_str()));
+				if (entity && entity->content) {
+					value.append(reinterpret_cast<const char*>(entity->content));
+				}
+			}
+			c = semicolon;
+		}
+		return value;
+	}
+
+	// an empty XML attribute counts as missing, as it has no value node in a document tree
+	bool getAttr(int count, const xmlChar** attributes, const char* name, std::string* value)
+	{
+		for (int i = 0; i < count; i++, attributes += 5) {
+			if (!strcmp(reinterpret_cast<const char*>(attributes[0]), name)) {
+				*value = decodeValue(attributes[3], attributes[4]);
+				return !value->empty();
+			}
+		}
+		return false;
+	}
+
+	void putElement(const xmlChar* localname, const xmlChar* prefix, int count, const xmlChar** attributes)
+	{
+		closeStartTag();
+
+		const char* name = reinterpret_cast<const char*>(localname);
+		loadElement(name, count, attributes);
+		m_depth++;
+
+		// clients read the attribute values through the protocol, only the context attributes keep theirs
+		bool keepValues = !strcmp(name, "context-attribute");
+
+		m_out.put('<');
+		putName(prefix, localname);
+		for (int i = 0; i < count; i++, attributes += 5) {
+			if (!keepValues && !strcmp(reinterpret_cast<const char*>(attributes[0]), "value")) {
+				continue;
+			}
+			m_out.put(' ');
+			putName(attributes[1], attributes[0]);
+			m_out.put("=\"");
+			m_out.putEscaped(decodeValue(attributes[3], attributes[4]), true);
+			m_out.put('"');
+		}
+		m_pending = true;
 	}
-	removeValueAttribute(node->children);
-	removeValueAttribute(node->next);
 
-	if (strcmp(reinterpret_cast<const char*>(node->name), "context-attribute") != 0) {
-		for (xmlAttr* attr = node->properties; attr; attr = attr->next) {
-			if (!strcmp(reinterpret_cast<const char*>(attr->name), "value")) {
-				xmlRemoveProp(attr);
+	// adds the attributes to the store and tracks the device capabilities
+	void loadElement(const char* name, int count, const xmlChar** attributes)
+	{
+		std::string attr, value;
+
+		switch (m_depth) {
+		case 0:
+			m_root = true;
+			break;
+		case 1:
+			m_device = !strcmp(name, "device") && getAttr(count, attributes, "id", &m_deviceId);
+			if (m_device) {
+				m_devices->push_back({m_deviceId, 0});
+				m_hasInput.push_back(false);
+			} else if (!strcmp(name, "context-attribute") && getAttr(count, attributes, "name", &attr)) {
+				getAttr(count, attributes, "value", &value);
+				m_store->add("", "", false, ATTR_SCOPE_CONTEXT, attr.c_str(), value.c_str());
+			}
+			break;
+		case 2:
+			m_channel = m_device && !strcmp(name, "channel");
+			m_channelAttrs = false;
+			if (m_channel) {
+				std::string type;
+				bool typed = getAttr(count, attributes, "type", &type);
+				m_output = type == "output";
+				m_channelAttrs = getAttr(count, attributes, "id", &m_channelId) && typed;
+				if (type == "input") {
+					m_hasInput.back() = true;
+				}
+			} else if (m_device && getAttr(count, attributes, "name", &attr)) {
+				AttrScope scope;
+				if (!strcmp(name, "attribute")) {
+					scope = ATTR_SCOPE_DEVICE;
+				} else if (!strcmp(name, "debug-attribute")) {
+					scope = ATTR_SCOPE_DEBUG;
+				} else if (!strcmp(name, "buffer-attribute")) {
+					scope = ATTR_SCOPE_BUFFER;
+				} else {
+					break;
+				}
+				getAttr(count, attributes, "value", &value);
+				m_store->add(m_deviceId.c_str(), "", false, scope, attr.c_str(), value.c_str());
+			}
+			break;
+		case 3:
+			if (!m_channel) {
 				break;
 			}
+			if (!strcmp(name, "scan-element")) {
+				m_devices->back().flags |= ContextImage::DEVICE_SCAN;
+			} else if (m_channelAttrs && !strcmp(name, "attribute") &&
+				   getAttr(count, attributes, "name", &attr)) {
+				getAttr(count, attributes, "value", &value);
+				m_store->add(m_deviceId.c_str(), m_channelId.c_str(), m_output, ATTR_SCOPE_CHANNEL,
+					     attr.c_str(), value.c_str());
+			}
+			break;
+		default:
+			break;
 		}
 	}
-}
 
-ssize_t iio_emu::getXml(struct _xmlDoc* doc, char** buf)
+private:
+	xmlParserCtxt* m_ctxt;
+	AttrStore* m_store;
+	std::vector<XmlDevice>* m_devices;
+	std::vector<bool> m_hasInput;
+	XmlWriter m_out;
+	int m_depth;
+	// the start tag of the last element is not closed yet
+	bool m_pending;
+
+	bool m_root;
+	bool m_device;
+	std::string m_deviceId;
+	bool m_channel;
+	bool m_channelAttrs;
+	std::string m_channelId;
+	bool m_output;
+};
+} // namespace
+
+static int stream(xmlParserCtxt* ctxt, AttrStore* store, std::vector<XmlDevice>* devices, std::string* xml)
 {
-	if (!doc) {
+	if (ctxt == nullptr) {
 		return -ENOENT;
 	}
 
-	xmlDoc* tmpDoc;
-	xmlChar* xml;
-	int size;
-
-	LIBXML_TEST_VERSION
+	int ret = ContextStream(ctxt, store, devices).run(xml);
+	// only the DTD was added to the document
+	xmlFreeDoc(ctxt->myDoc);
+	ctxt->myDoc = nullptr;
+	xmlFreeParserCtxt(ctxt);
+	store->finishLoading();
+	return ret;
+}
 
-	xmlDocDumpMemory(doc, &xml, &size);
+int iio_emu::streamXml(const char* path, AttrStore* store, std::vector<XmlDevice>* devices, std::string* xml)
+{
+	return stream(xmlCreateFileParserCtxt(path), store, devices, xml);
+}
 
-	tmpDoc = xmlReadMemory(reinterpret_cast<const char*>(xml), size, nullptr, nullptr, XML_PARSE_DTDVALID);
-	xmlFree(xml);
-	xmlNode* root = xmlDocGetRootElement(tmpDoc);
-	removeValueAttribute(root);
-	xmlDocDumpMemory(tmpDoc, &xml, &size);
+int iio_emu::streamXml(const char* data, size_t size, AttrStore* store, std::vector<XmlDevice>* devices,
+		       std::string* xml)
+{
+	return stream(xmlCreateMemoryParserCtxt(data, static_cast<int>(size)), store, devices, xml);
+}
 
-	if (xml == nullptr) {
+static int validate(xmlTextReader* reader)
+{
+	if (reader == nullptr) {
 		return -ENOENT;
 	}
 
-	std::string str(reinterpret_cast<const char*>(xml));
-	xmlFree(xml);
+	// libxml reports the validity errors as it reads
+	int ret;
+	while ((ret = xmlTextReaderRead(reader)) == 1) {
+	}
+	bool valid = ret == 0 && xmlTextReaderIsValid(reader) == 1;
+	xmlFreeTextReader(reader);
+	return valid ? 0 : -EINVAL;
+}
+
+int iio_emu::validateXml(const char* path) { return validate(xmlReaderForFile(path, nullptr, XML_PARSE_DTDVALID)); }
 
-	str.erase(std::remove(str.begin(), str.end(), '\n'), str.end());
-	std::string::iterator new_end =
-		std::unique(str.begin(), str.end(), [&](char l, char r) { return (l == r) && (l == ' '); });
-	str.erase(new_end, str.end());
-	const char* content = str.c_str();
+int iio_emu::validateXml(const char* data, size_t size)
+{
+	return validate(xmlReaderForMemory(data, static_cast<int>(size), nullptr, nullptr, XML_PARSE_DTDVALID));
+}
 
-	*buf = new char[str.size() + 1];
-	memcpy(*buf, content, str.size());
-	(*buf)[str.size()] = '\0';
+ssize_t iio_emu::compressXml(const char* xml, size_t len, char** buf)
+{
+	*buf = nullptr;
+#if defined(IIO_EMU_ZSTD)
+	size_t bound = ZSTD_compressBound(len);
+	auto out = new char[bound];
+
+	// compressed once at load; higher levels barely shrink the document further but take much longer
+	size_t size = ZSTD_compress(out, bound, xml, len, 9);
+	if (ZSTD_isError(size)) {
+		delete[] out;
+		return -EIO;
+	}
 
-	xmlFreeDoc(tmpDoc);
-	return static_cast<ssize_t>(str.size());
+	*buf = out;
+	return static_cast<ssize_t>(size);
+#else
+	UNUSED(xml);
+	UNUSED(len);
+	return -ENOSYS;
+#endif
 }
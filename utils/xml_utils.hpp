@@ -40,22 +40,38 @@
 #ifndef IIO_EMU_XML_UTILS_HPP
 #define IIO_EMU_XML_UTILS_HPP
 
+#include <cstdint>
+#include <string>
 #include <tinyiiod/tinyiiod.h>
-
-struct _xmlDoc;
-struct _xmlNode;
+#include <vector>
 
 namespace iio_emu {
 
-struct _xmlNode* getNode(struct _xmlNode* root, const char* node_name, const char* attr_name, const char* attr_value);
+class AttrStore;
 
-struct _xmlNode* getNode(struct _xmlNode* root, const char* node_name);
+struct XmlDevice
+{
+	std::string id;
+	// ContextImage::DeviceFlags
+	uint32_t flags;
+};
 
-struct _xmlNode* getDeviceAttr(struct _xmlDoc* doc, const char* dev, enum iio_attr_type type, const char* attr);
+/*
+ * Streams a context document, from a file or from memory, without building
+ * its tree. The attributes are added to the store, the devices are listed
+ * with their buffer capabilities and the client XML is rendered: without
+ * line breaks, with runs of spaces collapsed and without the attribute
+ * values, except the context attribute ones.
+ */
+int streamXml(const char* path, AttrStore* store, std::vector<XmlDevice>* devices, std::string* xml);
+int streamXml(const char* data, size_t size, AttrStore* store, std::vector<XmlDevice>* devices, std::string* xml);
 
-struct _xmlNode* getChannelAttr(struct _xmlDoc* doc, const char* chn, const char* dev, const char* attr, bool ch_out);
+// reads the document with DTD validation, -EINVAL when it is not valid
+int validateXml(const char* path);
+int validateXml(const char* data, size_t size);
 
-ssize_t getXml(struct _xmlDoc* doc, char** buf);
+// zstd frame of the serialized context, -ENOSYS when built without zstd
+ssize_t compressXml(const char* xml, size_t len, char** buf);
 
 } // namespace iio_emu
 #endif // IIO_EMU_XML_UTILS_HPP